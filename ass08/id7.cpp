@@ -308,11 +308,6 @@ int main()
 	tree = build(data, features, syms, availCol);
 	tree->printWithEdges();
 
-	// SEARCH DECISION TREE
-	Matrix query("Query");
-	query.readStrings(syms);
-
-
 	// a map starting with number 0 for first symbol
 	SymbolNumMap *fNames = new SymbolNumMap("Feature Names", 0);
 	for (int i=0; i<features.numRows(); i++) {
@@ -320,10 +315,14 @@ int main()
 		fNames->add(syms->getStr(features.get(i, 0))); 
 	}
 
-	for (int r=0; r<query.numRows(); r++) {
-		printf("%d ", r);
-		query.writeLineStrings(syms, r);
-		printf("%s\n", find(tree, syms, fNames, query, r).c_str());
+	// SEARCH DECISION TREE one query at a time as they are read
+	MatrixRowReader queries(Matrix::STRINGS, syms);
+	Matrix query("Query");
+	queries.readHeader();
+	while (queries.nextRow(query)) {
+		printf("%d ", queries.row()-1);
+		query.writeLineStrings(syms, 0);
+		printf("%s\n", find(tree, syms, fNames, query, 0).c_str());
 	}
 
 	return 0;
@@ -34,6 +34,15 @@
 //  all its elements.
 
 #include "mat.h"
+#include <algorithm>    // for std::stable_sort of row index lists and std::merge
+#include <thread>       // for parallel sorting
+#include <string.h>     // for memcpy of double bits into radix sort keys
+#include <charconv>     // for std::from_chars in the text matrix reader
+#include <sys/mman.h>   // for memory mapped matrix files
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>      // for INT_MAX in size checks
 // can do this "in class" in C++11
 char *Matrix::realFormat=(char *)"%8.4lf ";
 char *Matrix::intFormat=(char *)"%8d ";       // same width as realFormat
@@ -57,18 +66,84 @@ static bool gaussj(double **a, int n, double **b, int m);
 
 // constructor
 SymbolNumMap::SymbolNumMap(string namex, int startnum, string defaultValue) :
-    name(namex), startNum(startnum), defaultMissing(defaultValue), next(startnum){
+    name(namex), startNum(startnum), defaultMissing(defaultValue), next(startnum), offset(1, 0) {
 };
 
 
+// hash of a string of len bytes.  Takes 8 bytes at a time.
+static unsigned int hashSymbol(const char *s, size_t len)
+{
+    unsigned long long h = len * 0x9E3779B97F4A7C15ULL;
+    unsigned long long w;
+
+    while (len>=8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h>>31;
+        s += 8;
+        len -= 8;
+    }
+    w = 0;
+    memcpy(&w, s, len);
+    h = (h ^ w) * 0x94D049BB133111EBULL;
+    h ^= h>>29;
+
+    return (unsigned int)h;
+}
+
+
+// find the slot in the hash table holding the string s of len bytes
+// with hash h or else the empty slot where it would go.  The table
+// must not be full.
+size_t SymbolNumMap::findSlot(const char *s, size_t len, unsigned int h) const
+{
+    size_t mask = slot.size()-1;
+    size_t i;
+    int k;
+
+    for (i=h & mask; (k = slot[i])>=0; i=(i+1) & mask) {
+        if (hash[k]==h && offset[k+1]-offset[k]==len && memcmp(&arena[offset[k]], s, len)==0) break;
+    }
+
+    return i;
+}
+
+
+// make the hash table size slots and put the strings back in it
+void SymbolNumMap::rehash(size_t size)
+{
+    slot.assign(size, -1);
+    for (int k=0; k<next-startNum; k++) {
+        size_t i = hash[k] & (size-1);
+
+        while (slot[i]>=0) i = (i+1) & (size-1);
+        slot[i] = k;
+    }
+}
+
+
+// add the string s of len bytes if it isn't there otherwise look it up
+int SymbolNumMap::add(const char *s, size_t len) {
+    unsigned int h = hashSymbol(s, len);
+    size_t i;
+
+    // keep the table at most half full
+    if (2*size_t(next-startNum+1)>slot.size()) rehash(slot.size()<16 ? 16 : 2*slot.size());
+
+    i = findSlot(s, len, h);
+    if (slot[i]>=0) return startNum+slot[i];
+
+    slot[i] = next-startNum;
+    hash.push_back(h);
+    arena.insert(arena.end(), s, s+len);
+    offset.push_back(arena.size());
+    return next++;
+}
+
+
 // add a symbol to the map if it isn't there otherwise look it up
 int SymbolNumMap::add(string s) {
-    if (strToNum.find(s) == strToNum.end()) {
-        strToNum[s] = next;
-        numToStr[next] = s;
-        return next++;
-    }
-    return strToNum.find(s)->second;
+    return add(s.data(), s.length());
 }
 
 // add a symbol to the map if it isn't there otherwise look it up
@@ -79,17 +154,21 @@ int SymbolNumMap::add(const char *s) {
         exit(1);
     }
     else {
-        return add(std::string(s));
+        return add(s, strlen(s));
     }
 }
 
 
 // get the int map to the given string if it is there otherwise return -1
 int SymbolNumMap::getNum(const string s) const {
-    if (strToNum.find(s) == strToNum.end()) {
+    size_t i;
+
+    if (slot.size()==0) return -1;
+    i = findSlot(s.data(), s.length(), hashSymbol(s.data(), s.length()));
+    if (slot[i]<0) {
         return -1;
     }
-    return strToNum.find(s)->second;
+    return startNum+slot[i];
 }
 
 
@@ -112,10 +191,8 @@ string SymbolNumMap::getStrDefault(int n) const {
         printf("ERROR(SymbolNumMap::getStrDefault): index into labels must be an integer in the range %d to %d but is instead %d.\n", startNum, next-1, n);
         exit(1);
     }
-    if (numToStr.find(n) == numToStr.end()) {
-        return defaultMissing;
-    }
-    return numToStr.find(n)->second;
+    n -= startNum;
+    return string(arena.data()+offset[n], offset[n+1]-offset[n]);
 }
 
 
@@ -130,15 +207,15 @@ string SymbolNumMap::getStr(double x) const {
         printf("ERROR(SymbolNumMap::getStr): index into labels must be an integer in the range %d to %d but is instead %d.\n", startNum, next-1, n);
         exit(1);
     }
-    else if (numToStr.find(n) == numToStr.end()) {  
-        return defaultMissing;   // should never get here
-    }
-    return numToStr.find(n)->second;
+    n -= startNum;
+    return string(arena.data()+offset[n], offset[n+1]-offset[n]);
 }
 
 void SymbolNumMap::clear() {
-    strToNum.clear();
-    numToStr.clear();
+    arena.clear();
+    offset.assign(1, 0);
+    hash.clear();
+    slot.clear();
     next = startNum;
 }
 
@@ -155,7 +232,7 @@ void SymbolNumMap::print(string msg){
     }
 
     for (int i=startNum; i<next; i++) {
-        printf("%3d %s\n", i, numToStr[i].c_str());
+        printf("%3d %s\n", i, getStrDefault(i).c_str());
     }
     fflush(stdout);
 }
@@ -260,6 +337,13 @@ int MatrixRowIter::row()
 // turn on debugging here.   It shows when a matrix is allocated and then deallocated.
 bool Matrix::debug = false;
 
+// sorting large numbers of rows is done in parallel.  See qs and qsCol.
+int Matrix::sortThreads = 0;
+int Matrix::parallelSortMin = 100000;
+int Matrix::radixSortMin = 2048;
+int Matrix::readThreads = 0;
+int Matrix::parallelReadMin = 1<<22;
+
 void Matrix::allocate(int r, int c, std::string namex, bool isSubMatrix)
 {
     if (isSubMatrix) c=-1;    // how you signal you are allocating a submatrix
@@ -286,6 +370,8 @@ void Matrix::allocate(int r, int c, std::string namex, bool isSubMatrix)
 
     defined = false;
     submatrix = isSubMatrix;
+    mapped = NULL;
+    mappedSize = 0;
     if (debug) printf("DEBUG(  allocate): name \"%s\", size %d X %d\n", name.c_str(), r, c);
 }
 
@@ -296,10 +382,12 @@ bool Matrix::deallocate()
 
     allocated = (m!=NULL);
     if (allocated) {
-        if (!submatrix) for (int i=0; i<maxr; i++) delete [] m[i];
+        if (!submatrix && !mapped) for (int i=0; i<maxr; i++) delete [] m[i];
         delete [] m;
         m = NULL;   // to be sure
     }
+    if (mapped) munmap(mapped, mappedSize);
+    mapped = NULL;
 
     if (debug) printf("DEBUG(deallocate): name \"%s\", size %d X %d\n", name.c_str(), maxr, maxc);
 
@@ -313,9 +401,10 @@ bool Matrix::deallocate()
 
 
 // zzz can be made more efficient!!!
+// A mapped matrix always gets ordinary memory.
 void Matrix::reallocate(int otherMaxr, int otherMaxc, std::string namex)
 {
-    if (maxr!=otherMaxr || maxc!=otherMaxc) {
+    if (maxr!=otherMaxr || maxc!=otherMaxc || mapped) {
         if (debug) printf("DEBUG(reallocate): name \"%s\", size %d X %d\n", name.c_str(), otherMaxr, otherMaxc);
         deallocate();
         allocate(otherMaxr, otherMaxc, namex);
@@ -501,6 +590,10 @@ void Matrix::narrow(int newc)
 void Matrix::widen(int newc, double fill)
 {
     assertDefined("widen");
+    if (mapped) {
+        printf("ERROR(widen): matrix \"%s\" is a mapped file and cannot be widened\n", name.c_str());
+        exit(1);
+    }
     if (newc<=maxc) {
         if (name.length()==0)
             printf("ERROR(widen): new width %d for matrix is less than or equal to old withd %d\n", newc, maxc);
@@ -531,6 +624,10 @@ void Matrix::lengthen(int newr, double fill)
     double **newrows;
 
     assertDefined("lengthen");
+    if (mapped) {
+        printf("ERROR(lengthen): matrix \"%s\" is a mapped file and cannot be lengthened\n", name.c_str());
+        exit(1);
+    }
     if (newr<=maxr) {
         if (name.length()==0)
             printf("ERROR(lengthen): new length %d for matrix is less than or equal to old withd %d\n", newr, maxr);
@@ -900,6 +997,35 @@ void Matrix::assertRandInitialized(std::string msg) const
 }
 
 
+// assert self is a column vector of n row numbers that is a
+// permutation of 0...n-1 such as produced by argsortByCol
+void Matrix::assertPermutation(int n, std::string msg) const
+{
+    assertDefined(msg);
+    assertColVector(msg);
+    if (maxr!=n) {
+        printf("ERROR(%s): permutation has %d entries but there are %d rows\n", msg.c_str(), maxr, n);
+        exit(1);
+    }
+
+    std::vector<bool> seen(n, false);
+    for (int r=0; r<maxr; r++) {
+        int i = int(m[r][0]);
+
+        if (i<0 || i>=n || i!=m[r][0]) {
+            printf("ERROR(%s): permutation entry %d is %lg which is not a row number in 0..%d\n",
+                   msg.c_str(), r, m[r][0], n-1);
+            exit(1);
+        }
+        if (seen[i]) {
+            printf("ERROR(%s): row number %d appears twice in permutation\n", msg.c_str(), i);
+            exit(1);
+        }
+        seen[i] = true;
+    }
+}
+
+
 // helper function that swaps two rows and does not check matrix for validity
 void Matrix::swapRows(int i, int j)
 {
@@ -3012,16 +3138,41 @@ Matrix &Matrix::initLinear(double A, double B, double C)
 
 
 
- // fill with random doubles in the given range: [min, max)
-Matrix &Matrix::rand(double min, double max)
+// fill the maxr X maxc rows of m using fill(x, n) which puts n random
+// values in x.  Narrow rows are filled through a buffer so the bulk
+// random fills always get a decent sized block.
+template <class Fill>
+static void fillRows(double **m, int maxr, int maxc, Fill fill)
 {
-    assertRandInitialized("rand");
+    const int block = 1024;
+    double buffer[block];
+    int r, c;
 
-    for (int r=0; r<maxr; r++) {
-        for (int c=0; c<maxc; c++) {
-            m[r][c] = randUnit()*(max-min) + min;
+    if (maxc<=0) return;
+    if (maxc>=block/4) {
+        for (r=0; r<maxr; r++) fill(m[r], maxc);
+        return;
+    }
+
+    r = c = 0;
+    while (r<maxr) {
+        int n = std::min((long long)block, (long long)(maxr-r)*maxc - c);
+
+        fill(buffer, n);
+        for (int i=0; i<n; i++) {
+            m[r][c] = buffer[i];
+            if (++c==maxc) { c = 0; r++; }
         }
     }
+}
+
+
+// fill with random doubles in the given range: [min, max)
+Matrix &Matrix::rand(double min, double max)
+{
+    assertRandInitialized("rand");
+
+    fillRows(m, maxr, maxc, [min, max](double *x, int n) { randFillUniform(x, n, min, max); });
 
     defined = true;
 
@@ -3035,8 +3186,10 @@ Matrix &Matrix::randCol(int c, double min, double max)
 {
     assertRandInitialized("randCol");
 
+    std::vector<double> x(maxr);
+    randFillUniform(x.data(), maxr, min, max);
     for (int r=0; r<maxr; r++) {
-        m[r][c] = randUnit()*(max-min) + min;
+        m[r][c] = x[r];
     }
 
     return *this;
@@ -3048,11 +3201,7 @@ Matrix &Matrix::randNorm(double mean, double stddev)
 {
     assertRandInitialized("randNorm");
 
-    for (int r=0; r<maxr; r++) {
-        for (int c=0; c<maxc; c++) {
-            m[r][c] = ::randNorm(stddev) + mean;
-        }
-    }
+    fillRows(m, maxr, maxc, [mean, stddev](double *x, int n) { randFillNormal(x, n, mean, stddev); });
 
     defined = true;
 
@@ -3064,13 +3213,16 @@ Matrix &Matrix::randNorm(double mean, double stddev)
 Matrix &Matrix::rand(int min, int max)
 {
     assertRandInitialized("rand");
-
-    for (int r=0; r<maxr; r++) {
-        for (int c=0; c<maxc; c++) {
-            m[r][c] = randMod(max-min) + min;
-        }
+    if (max<=min) {
+        if (name.length()==0)
+            printf("ERROR(rand): the range [%d, %d) is empty\n", min, max);
+        else
+            printf("ERROR(rand): the range [%d, %d) for matrix \"%s\" is empty\n", min, max, name.c_str());
+        exit(1);
     }
 
+    fillRows(m, maxr, maxc, [min, max](double *x, int n) { randFillInt(x, n, min, max); });
+
     defined = true;
 
     return *this;
@@ -3382,6 +3534,207 @@ Matrix &Matrix::inverse()
 }
 
 
+// The print and write routines below format numbers with std::to_chars
+// into a large buffer that goes to stdout with one fwrite per block
+// rather than calling printf once per element.  The printf format in
+// use (realFormat and friends, or the one given to printFmt) is
+// compiled once per call into a NumberFormat, which gives exactly what
+// printf would for that format.  to_chars is defined to produce the
+// same digits as printf for %f, %e and %g, and the flags and width are
+// applied here.  Anything else (%#g, %E, %.3d, ...) simply goes through
+// snprintf into the buffer.  Routines that look up strings flush each
+// row so a bad label error still shows the rows before it.
+
+// output buffer for stdout.  Anything printed with printf must be
+// flushed first to keep the order (see flush).
+struct OutBuffer {
+    static const int size = 1<<16;
+    char buffer[size];
+    int n;
+
+    OutBuffer() { n = 0; }
+    ~OutBuffer() { flush(); }
+
+    void flush() {
+        if (n>0) fwrite(buffer, 1, n, stdout);
+        n = 0;
+    }
+
+    // make sure there is room for len more characters
+    char *room(int len) {
+        if (n+len>size) flush();
+        return buffer+n;
+    }
+
+    void put(char ch) {
+        if (n==size) flush();
+        buffer[n++] = ch;
+    }
+
+    void put(const char *str, int len) {
+        if (len>size) {
+            flush();
+            fwrite(str, 1, len, stdout);
+            return;
+        }
+        memcpy(room(len), str, len);
+        n += len;
+    }
+
+    void put(const std::string &str) { put(str.c_str(), str.length()); }
+};
+
+
+// a printf format with one conversion for a double or an int
+struct NumberFormat {
+    const char *fmt;            // the original format
+    std::string prefix;         // literal text before the conversion
+    std::string suffix;         // literal text after the conversion
+    bool fast;                  // false means use snprintf
+    bool left, zero, plus, space;
+    int width;
+    int precision;              // -1 if not given
+    char conv;                  // f, e, g or d
+
+    NumberFormat(const char *format);
+    void put(OutBuffer &out, double x) const;
+    void put(OutBuffer &out, int x) const;
+    void pad(OutBuffer &out, const char *digits, int len, bool finite) const;
+};
+
+
+// split the format into literal text and one conversion and see if the
+// conversion is one to_chars can do
+NumberFormat::NumberFormat(const char *format)
+{
+    const char *p;
+
+    fmt = format;
+    fast = false;
+    left = zero = plus = space = false;
+    width = 0;
+    precision = -1;
+    conv = ' ';
+
+    // literal text up to the conversion
+    for (p=format; *p; p++) {
+        if (*p=='%') {
+            if (p[1]=='%') prefix += *p++;
+            else break;
+        }
+        else prefix += *p;
+    }
+    if (*p!='%') return;
+    p++;
+
+    // flags, width, precision and length
+    for (;; p++) {
+        if (*p=='-') left = true;
+        else if (*p=='0') zero = true;
+        else if (*p=='+') plus = true;
+        else if (*p==' ') space = true;
+        else break;
+    }
+    while (*p>='0' && *p<='9') width = 10*width + *p++ - '0';
+    if (*p=='.') {
+        p++;
+        precision = 0;
+        while (*p>='0' && *p<='9') precision = 10*precision + *p++ - '0';
+    }
+    if (*p=='l') p++;
+    if (!(*p=='f' || *p=='e' || *p=='g' || *p=='d')) return;
+    conv = *p++;
+    if (conv=='d' && precision>=0) return;
+
+    // literal text after the conversion
+    for (; *p; p++) {
+        if (*p=='%') {
+            if (p[1]=='%') suffix += *p++;
+            else return;
+        }
+        else suffix += *p;
+    }
+
+    fast = true;
+}
+
+
+// put the converted digits with sign flags and padding to width
+void NumberFormat::pad(OutBuffer &out, const char *digits, int len, bool finite) const
+{
+    char sign = 0;
+    int fill;
+
+    if (digits[0]!='-') {
+        if (plus) sign = '+';
+        else if (space) sign = ' ';
+    }
+    fill = width - len - (sign!=0);
+
+    out.put(prefix);
+    if (left) {
+        if (sign) out.put(sign);
+        out.put(digits, len);
+        for (int i=0; i<fill; i++) out.put(' ');
+    }
+    else if (zero && finite) {
+        if (sign) out.put(sign);
+        if (digits[0]=='-') {
+            out.put('-');
+            digits++;
+            len--;
+        }
+        for (int i=0; i<fill; i++) out.put('0');
+        out.put(digits, len);
+    }
+    else {
+        for (int i=0; i<fill; i++) out.put(' ');
+        if (sign) out.put(sign);
+        out.put(digits, len);
+    }
+    out.put(suffix);
+}
+
+
+void NumberFormat::put(OutBuffer &out, double x) const
+{
+    char digits[400];
+    std::to_chars_result result;
+
+    if (!fast || conv=='d') {
+        int len = snprintf(digits, sizeof(digits), fmt, x);
+        out.put(digits, len<(int)sizeof(digits) ? len : (int)sizeof(digits)-1);
+        return;
+    }
+
+    if (conv=='f') result = std::to_chars(digits, digits+sizeof(digits), x, std::chars_format::fixed, precision<0 ? 6 : precision);
+    else if (conv=='e') result = std::to_chars(digits, digits+sizeof(digits), x, std::chars_format::scientific, precision<0 ? 6 : precision);
+    else result = std::to_chars(digits, digits+sizeof(digits), x, std::chars_format::general, precision<0 ? 6 : precision);
+
+    if (result.ec!=std::errc()) {
+        int len = snprintf(digits, sizeof(digits), fmt, x);
+        out.put(digits, len<(int)sizeof(digits) ? len : (int)sizeof(digits)-1);
+        return;
+    }
+    pad(out, digits, result.ptr-digits, std::isfinite(x));
+}
+
+
+void NumberFormat::put(OutBuffer &out, int x) const
+{
+    char digits[32];
+
+    if (!fast || conv!='d') {
+        int len = snprintf(digits, sizeof(digits), fmt, x);
+        out.put(digits, len<(int)sizeof(digits) ? len : (int)sizeof(digits)-1);
+        return;
+    }
+
+    std::to_chars_result result = std::to_chars(digits, digits+sizeof(digits), x);
+    pad(out, digits, result.ptr-digits, true);
+}
+
+
 // just print the size and name of the matrix
 void Matrix::printSize(std::string msg, bool size) const
 {
@@ -3415,13 +3768,15 @@ const Matrix &Matrix::printFmt(std::string msg, std::string fmt, bool size)
 
     if (fmt=="") fmt=Matrix::realFormat;
 
-    const char *fmtStr = fmt.c_str();  // convert once
+    NumberFormat format(fmt.c_str());  // convert once
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
-            printf(fmtStr, m[r][c]);
+            format.put(out, m[r][c]);
         }
-        printf("\n");
+        out.put('\n');
     }
+    out.flush();
 
     fflush(stdout);
 
@@ -3435,12 +3790,15 @@ const Matrix &Matrix::print(std::string msg, bool size, bool newline) const
 
     printSize(msg, size);
 
+    NumberFormat format(realFormat);
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
-            printf(realFormat, m[r][c]);
+            format.put(out, m[r][c]);
         }
-        if (newline) printf("\n");
+        if (newline) out.put('\n');
     }
+    out.flush();
 
     fflush(stdout);
 
@@ -3455,16 +3813,20 @@ void Matrix::printInt(std::string msg, bool size) const
 
     printSize(msg, size);
 
+    NumberFormat format(shortIntFormat);
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
             if (m[r][c] != int(m[r][c])) {
+                out.flush();
                 printf("ERROR(printInt): Trying to print an integer matrix but element at position %d, %d is %10.5lg which is not an integer\n", r, c, m[r][c]);
                 exit(1);
             }
-            printf(shortIntFormat, int(m[r][c]));
+            format.put(out, int(m[r][c]));
         }
-        printf("\n");
+        out.put('\n');
     }
+    out.flush();
 
     fflush(stdout);
 }
@@ -3547,17 +3909,20 @@ void Matrix::printNZ(double epsilon, std::string msg, bool size) const
 
     printSize(msg, size);
 
+    NumberFormat zeroFormat(intFormat), format(realFormat);
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
             if (fabs(m[r][c]) < epsilon) {
-                printf(intFormat, 0);
+                zeroFormat.put(out, 0);
             }
             else {
-                printf(realFormat, m[r][c]);
+                format.put(out, m[r][c]);
             }
         }
-        printf("\n");
+        out.put('\n');
     }
+    out.flush();
 
     fflush(stdout);
 }
@@ -3577,17 +3942,22 @@ void Matrix::printLabeledRow(const SymbolNumMap *labels,
 
     printSize(msg, size);
 
+    NumberFormat format(realFormat);
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
             if (c==labelCol) {
-                    printf("%s ", labels->getStr(m[r][labelCol]).c_str());
+                    out.put(labels->getStr(m[r][labelCol]));
+                    out.put(' ');
             }
             else {
-                printf(realFormat, m[r][c]);
+                format.put(out, m[r][c]);
             }
         }
-        printf("\n");
+        out.put('\n');
+        out.flush();
     }
+    out.flush();
 
     fflush(stdout);
 }
@@ -3600,12 +3970,16 @@ void Matrix::printStrings(const SymbolNumMap *symbols, std::string msg, bool siz
 
     printSize(msg, size);
 
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
-            printf("%s ", symbols->getStr(m[r][c]).c_str());
+            out.put(symbols->getStr(m[r][c]));
+            out.put(' ');
         }
-        printf("\n");
+        out.put('\n');
+        out.flush();
     }
+    out.flush();
 
     fflush(stdout);
 }
@@ -3618,12 +3992,16 @@ void Matrix::write() const
     assertDefined("write");
 
     printf("%d %d\n", maxr, maxc);
+
+    NumberFormat format("%.15lg ");
+    OutBuffer out;
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
-            printf("%.15lg ", m[r][c]);
+            format.put(out, m[r][c]);
         }
-        printf("\n");
+        out.put('\n');
     }
+    out.flush();
 }
 
 
@@ -3635,9 +4013,12 @@ void Matrix::writeLine(int r) const
     assertDefined("writeLine");
     assertIndexOK(r, 0, "writeLine");
 
+    NumberFormat format(realFormat);
+    OutBuffer out;
     for (int c=0; c<maxc; c++) {
-        printf(realFormat, m[r][c]);
+        format.put(out, m[r][c]);
     }
+    out.flush();
 }
 
 
@@ -3648,9 +4029,12 @@ void Matrix::writeLineStrings(const SymbolNumMap *symbols, int r) const
     assertDefined("writeLineStrings");
     assertIndexOK(r, 0, "writeLineStrings");
 
+    OutBuffer out;
     for (int c=0; c<maxc; c++) {
-        printf("%s ", symbols->getStr(m[r][c]).c_str());
+        out.put(symbols->getStr(m[r][c]));
+        out.put(' ');
     }
+    out.flush();
 }
 
 
@@ -3660,10 +4044,16 @@ void Matrix::writeLineStrings(const SymbolNumMap *symbols, int r, int strcol) co
     assertDefined("writeLineStrings");
     assertIndexOK(r, 0, "writeLineStrings");
 
+    NumberFormat format(realFormat);
+    OutBuffer out;
     for (int c=0; c<maxc; c++) {
-        if (c==strcol) printf("%s ", symbols->getStr(m[r][c]).c_str());
-        else printf(realFormat, m[r][c]);
+        if (c==strcol) {
+            out.put(symbols->getStr(m[r][c]));
+            out.put(' ');
+        }
+        else format.put(out, m[r][c]);
     }
+    out.flush();
 }
 
 
@@ -3725,11 +4115,324 @@ static inline bool strisin(const char s, const char *t)
 
 
 
+// The text readers below replace scanf("%lf") and friends.  They pull
+// characters with getc_unlocked so they share stdio's buffered chunks
+// of the stream with any scanf calls the caller makes between reads,
+// and convert numbers with std::from_chars which skips the format
+// parsing and locale work scanf does for every element.  Each behaves
+// like the scanf call it replaces: it returns 1 on success, 0 for input
+// that is not a number (with the offending character in bad) or EOF if
+// only whitespace is left.  The character after a token is pushed back.
+
+// read the next whitespace separated token and return its length or
+// EOF if there is no token.  A token of at most size-1 characters is put
+// in buffer.  A longer one is put whole in longToken (and its start in
+// buffer) so nothing is ever cut off.
+static int readToken(FILE *IN, char *buffer, int size, std::string *longToken)
+{
+    int ch, len;
+
+    do ch = getc_unlocked(IN); while (ch==' ' || ch=='\n' || ch=='\t' || ch=='\r' || ch=='\f' || ch=='\v');
+    if (ch==EOF) return EOF;
+
+    len = 0;
+    do {
+        if (len<size-1) buffer[len++] = ch;
+        else {
+            if (len==size-1) longToken->assign(buffer, len);
+            *longToken += (char)ch;
+            len++;
+        }
+        ch = getc_unlocked(IN);
+    } while (ch!=EOF && ch!=' ' && ch!='\n' && ch!='\t' && ch!='\r' && ch!='\f' && ch!='\v');
+    if (ch!=EOF) ungetc(ch, IN);
+    buffer[len<size-1 ? len : size-1] = '\0';
+
+    return len;
+}
+
+
+// convert the token in buffer (len characters, null terminated) like
+// scanf("%lf").  Anything from_chars does not take (a leading '+', hex
+// floats, out of range values) goes to strtod so the same inputs are
+// accepted as before.
+static int parseDouble(char *buffer, int len, double &x, char &bad)
+{
+    const char *start;
+    char *end;
+
+    start = buffer + (buffer[0]=='+');
+    std::from_chars_result result = std::from_chars(start, buffer+len, x);
+    if (result.ec==std::errc() && result.ptr==buffer+len) return 1;
+
+    x = strtod(buffer, &end);
+    if (end==buffer+len && len>0) return 1;
+
+    bad = *end;
+    return 0;
+}
+
+
+// tokens of the number readers up to this size-1 characters are read
+// into a buffer on the stack, longer ones into a string
+static const int readDoubleSize = 128;
+
+
+// read a double like scanf("%lf").  Unlike scanf a token with junk
+// after the number (like 3.5abc) is an error rather than read in part.
+static int readDouble(FILE *IN, double &x, char &bad)
+{
+    char buffer[readDoubleSize];
+    std::string longToken;
+    int len;
+
+    len = readToken(IN, buffer, readDoubleSize, &longToken);
+    if (len==EOF) return EOF;
+    if (len>readDoubleSize-1) return parseDouble(&longToken[0], len, x, bad);
+
+    return parseDouble(buffer, len, x, bad);
+}
+
+
+// read an int like scanf("%d")
+static int readInt(FILE *IN, int &x, char &bad)
+{
+    const int size = 64;
+    char buffer[size];
+    std::string longToken;
+    const char *token, *start;
+    int len;
+
+    len = readToken(IN, buffer, size, &longToken);
+    if (len==EOF) return EOF;
+    token = len>size-1 ? longToken.c_str() : buffer;
+
+    start = token + (token[0]=='+');
+    std::from_chars_result result = std::from_chars(start, token+len, x);
+    if (result.ec==std::errc() && result.ptr==token+len) return 1;
+
+    bad = (result.ec==std::errc() || result.ptr==start) ? *result.ptr : token[0];
+    return 0;
+}
+
+
+// Parallel parsing of big numeric text files.  The body of the file
+// (everything after the current position) is mapped and split at
+// newlines into one chunk per thread.  Since a newline is whitespace no
+// token straddles two chunks, but rows need not be one per line so each
+// thread first counts the tokens in its chunk.  A running sum of the
+// counts gives the element each chunk starts at and the threads then
+// parse their chunks straight into the rows.  Each thread stops at its
+// first bad token and the earliest one over all chunks is reported, so
+// errors are the same as the serial reader gives.
+
+static inline bool isReadSpace(char ch)
+{
+    return ch==' ' || ch=='\n' || ch=='\t' || ch=='\r' || ch=='\f' || ch=='\v';
+}
+
+
+// count the whitespace separated tokens in p...end-1
+static long long countTokens(const char *p, const char *end)
+{
+    long long count = 0;
+
+    while (p<end) {
+        while (p<end && isReadSpace(*p)) p++;
+        if (p==end) break;
+        count++;
+        while (p<end && !isReadSpace(*p)) p++;
+    }
+
+    return count;
+}
+
+
+// convert one token of a mapped file like readDouble.  Tokens are not
+// null terminated so only the uncommon ones readDouble sends to strtod
+// are copied into a buffer first (a string if they are long).
+static int scanDouble(const char *token, int len, double &x, char &bad)
+{
+    char buffer[readDoubleSize];
+    const char *start = token + (token[0]=='+');
+
+    std::from_chars_result result = std::from_chars(start, token+len, x);
+    if (result.ec==std::errc() && result.ptr==token+len) return 1;
+
+    if (len>readDoubleSize-1) {
+        std::string longToken(token, len);
+
+        return parseDouble(&longToken[0], len, x, bad);
+    }
+    memcpy(buffer, token, len);
+    buffer[len] = '\0';
+
+    return parseDouble(buffer, len, x, bad);
+}
+
+
+// what one thread found in its chunk
+struct ReadChunk {
+    const char *begin, *end;   // the chunk
+    long long first;           // element number of the first token
+    long long count;           // number of tokens
+    long long badElement;      // element number of the first bad token or -1
+    char bad;                  // first character of the bad token
+    const char *stop;          // just past the last element of the matrix if in this chunk
+};
+
+
+// parse the tokens of chunk into elements first...n-1 of a matrix with
+// maxc columns
+static void parseChunk(ReadChunk &chunk, long long n, int maxc, double **m)
+{
+    const char *p = chunk.begin;
+    const char *end = chunk.end;
+    const char *token;
+    long long k = chunk.first;
+    int r = k/maxc, c = k%maxc;
+
+    while (k<n) {
+        while (p<end && isReadSpace(*p)) p++;
+        if (p==end) break;
+        token = p;
+        while (p<end && !isReadSpace(*p)) p++;
+
+        if (scanDouble(token, p-token, m[r][c], chunk.bad)!=1) {
+            chunk.badElement = k;
+            return;
+        }
+        if (++c==maxc) { c = 0; r++; }
+        k++;
+    }
+    if (k==n) chunk.stop = p;
+}
+
+
+// parse the numeric body of the matrix from IN with threads.  Returns
+// false having read nothing if IN is not a regular file, the rest of it
+// is shorter than parallelReadMin or readThreads says not to; the
+// caller should then read serially.  Otherwise IN is left just after
+// the last element like the serial reader leaves it.
+bool Matrix::readRawParallel(FILE *IN)
+{
+    struct stat info;
+    long start;
+    size_t size;
+    void *map;
+    const char *text;
+    int threads;
+    long long n, total;
+
+    threads = readThreads;
+    if (threads<=0) threads = std::thread::hardware_concurrency();
+    if (threads<=1) return false;
+
+    if (fstat(fileno(IN), &info)!=0 || !S_ISREG(info.st_mode)) return false;
+    start = ftell(IN);
+    if (start<0 || info.st_size-start<parallelReadMin || info.st_size-start<=0) return false;
+    size = info.st_size-start;
+    if ((long long)size<(long long)threads*65536) threads = size/65536;   // at least 64KB each
+    if (threads<=1) return false;
+
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(IN), 0);
+    if (map==MAP_FAILED) return false;
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+    text = (const char *)map + start;
+
+    // split at newlines
+    std::vector<ReadChunk> chunk(threads);
+    size_t cut = 0;
+    for (int i=0; i<threads; i++) {
+        chunk[i].begin = text+cut;
+        if (i==threads-1) cut = size;
+        else {
+            size_t want = size*(i+1)/threads;
+            if (want>cut) cut = want;
+            while (cut<size && text[cut-1]!='\n') cut++;
+        }
+        chunk[i].end = text+cut;
+        chunk[i].badElement = -1;
+        chunk[i].stop = NULL;
+    }
+
+    // count the tokens in each chunk
+    std::vector<std::thread> pool;
+    for (int i=0; i<threads; i++) {
+        pool.push_back(std::thread([&chunk, i]() {
+            chunk[i].count = countTokens(chunk[i].begin, chunk[i].end);
+        }));
+    }
+    for (unsigned int i=0; i<pool.size(); i++) pool[i].join();
+    pool.clear();
+
+    total = 0;
+    for (int i=0; i<threads; i++) {
+        chunk[i].first = total;
+        total += chunk[i].count;
+    }
+
+    // parse the chunks that hold elements of the matrix
+    n = (long long)maxr*maxc;
+    for (int i=0; i<threads; i++) {
+        if (chunk[i].first>=n) break;
+        pool.push_back(std::thread([&chunk, i, n, this]() {
+            parseChunk(chunk[i], n, maxc, m);
+        }));
+    }
+    for (unsigned int i=0; i<pool.size(); i++) pool[i].join();
+
+    // report the earliest problem as the serial reader would
+    for (int i=0; i<threads; i++) {
+        if (chunk[i].badElement>=0) {
+            int r = chunk[i].badElement/maxc, c = chunk[i].badElement%maxc;
+
+            printf("ERROR(read): invalid number when trying to read row: %d and col: %d.  First character is '%c'\n", r, c, chunk[i].bad);
+            exit(1);
+        }
+    }
+    if (total<n) {
+        int r = total/maxc, c = total%maxc;
+
+        if (name.length()==0) {
+            printf("ERROR(read): Trying to read element [%d, %d] of a matrix but end of file was found\n", r, c);
+        }
+        else {
+            printf("ERROR(read): Trying to read element [%d, %d] of matrix named \"%s\" but end of file was found\n", r, c, name.c_str());
+        }
+        exit(1);
+    }
+
+    // leave IN after the last element
+    for (int i=0; i<threads; i++) {
+        if (chunk[i].stop!=NULL) fseek(IN, start+(chunk[i].stop-text), SEEK_SET);
+    }
+    munmap(map, info.st_size);
+
+    return true;
+}
+
+
 // read in the matrix assuming the size of the matrix determines
 // how many elements to read
 SymbolNumMap *Matrix::readRaw(ElementType labeled, SymbolNumMap *syms)
+{
+    return readRaw(stdin, labeled, syms);
+}
+
+
+// read in the matrix from IN assuming the size of the matrix determines
+// how many elements to read
+SymbolNumMap *Matrix::readRaw(FILE *IN, ElementType labeled, SymbolNumMap *syms)
 {
     int numread;
+    char bad;
+
+    // big numeric bodies in regular files are parsed in parallel
+    if (labeled==NUM && readRawParallel(IN)) {
+        defined = true;
+        return syms;
+    }
 
     // allocate a SymbolNumMap if needed but not supplied
     if (syms==NULL && (labeled==LABELEDROW || labeled==STRINGS)) {
@@ -3739,13 +4442,14 @@ SymbolNumMap *Matrix::readRaw(ElementType labeled, SymbolNumMap *syms)
     // get matrix
     const int bufferSize=4096;   // buffer
     char buffer[bufferSize];
+    std::string longToken;       // for strings too long for buffer
 
     for (int r=0; r<maxr; r++) {
         for (int c=0; c<maxc; c++) {
 
             // read in a string?
             if ((labeled==LABELEDROW && c==0) || labeled==STRINGS) {
-                numread = scanf("%s", buffer);
+                numread = readToken(IN, buffer, bufferSize, &longToken);
                 if (numread==EOF) {
                     if (name.length()==0) {
                         printf("ERROR(read): Trying to read element [%d, %d] of a matrix but end of file was found\n", r, c);
@@ -3755,12 +4459,12 @@ SymbolNumMap *Matrix::readRaw(ElementType labeled, SymbolNumMap *syms)
                     }
                     exit(1);
                 }
-                m[r][c] = syms->add(buffer);   // effectively numeric pointer to the syms
+                m[r][c] = syms->add(numread>bufferSize-1 ? longToken.c_str() : buffer);   // effectively numeric pointer to the syms
             }
 
             // read in a number?
             else {
-                numread = scanf("%lf", &(m[r][c]));
+                numread = readDouble(IN, m[r][c], bad);
                 if (numread==EOF) {
                     if (name.length()==0) {
                         printf("ERROR(read): Trying to read element [%d, %d] of a matrix but end of file was found\n", r, c);
@@ -3771,7 +4475,7 @@ SymbolNumMap *Matrix::readRaw(ElementType labeled, SymbolNumMap *syms)
                     exit(1);
                 }
                 if (numread!=1) {
-                    printf("ERROR(read): invalid number when trying to read row: %d and col: %d.  First character is '%c'\n", r, c, getchar());
+                    printf("ERROR(read): invalid number when trying to read row: %d and col: %d.  First character is '%c'\n", r, c, bad);
                     exit(1);
                 }
             }
@@ -3788,43 +4492,52 @@ SymbolNumMap *Matrix::readRaw(ElementType labeled, SymbolNumMap *syms)
 // support function for read functions
 SymbolNumMap *Matrix::readAux(ElementType labeled, bool transpose, SymbolNumMap *syms)
 {
+    return readAux(stdin, labeled, transpose, syms);
+}
+
+
+// support function for read functions reading from IN
+SymbolNumMap *Matrix::readAux(FILE *IN, ElementType labeled, bool transpose, SymbolNumMap *syms)
+{
+    const char *where = (IN==stdin) ? "stdin" : "file";
     int r, c;
     int numread;
+    char bad;
 
     // try to read in the number of rows
-    numread = scanf("%d", &r);
+    numread = readInt(IN, r, bad);
     if (numread==EOF) {
         if (name.length()==0) {
-            printf("ERROR(read): Trying to read a matrix from stdin, but end of file was found\n");
+            printf("ERROR(read): Trying to read a matrix from %s, but end of file was found\n", where);
         }
         else {
-            printf("ERROR(read): Trying to read matrix named \"%s\" from stdin, but end of file was found\n", name.c_str());
+            printf("ERROR(read): Trying to read matrix named \"%s\" from %s, but end of file was found\n", name.c_str(), where);
         }
         exit(1);
     }
     if (numread!=1) {
         if (name.length()==0) {
-            printf("ERROR(read): The number of rows was not a valid integer.  First character is '%c'\n", getchar());
+            printf("ERROR(read): The number of rows was not a valid integer.  First character is '%c'\n", bad);
         }
         else {
-            printf("ERROR(read): While trying to read matrix \"%s\", number of rows was not a valid integer.  First character is '%c'\n", name.c_str(), getchar());
+            printf("ERROR(read): While trying to read matrix \"%s\", number of rows was not a valid integer.  First character is '%c'\n", name.c_str(), bad);
         }
         exit(1);
     }
 
     // try to read in the number of columns
-    numread = scanf("%d", &c);
+    numread = readInt(IN, c, bad);
     if (numread==EOF) {
         if (name.length()==0) {
-            printf("ERROR(read): Trying to read a matrix from stdin but end of file was found\n");
+            printf("ERROR(read): Trying to read a matrix from %s but end of file was found\n", where);
         }
         else {
-            printf("ERROR(read): Trying to read matrix named \"%s\" from stdin but end of file was found\n", name.c_str());
+            printf("ERROR(read): Trying to read matrix named \"%s\" from %s but end of file was found\n", name.c_str(), where);
         }
         exit(1);
     }
     if (numread!=1) {
-        printf("ERROR(read): number of columns was not a valid integer.  First character is '%c'\n", getchar());
+        printf("ERROR(read): number of columns was not a valid integer.  First character is '%c'\n", bad);
         exit(1);
     }
 
@@ -3841,7 +4554,7 @@ SymbolNumMap *Matrix::readAux(ElementType labeled, bool transpose, SymbolNumMap
         reallocate(r, c, name);
     }
 
-    return readRaw(labeled, syms);
+    return readRaw(IN, labeled, syms);
 }    
 
 
@@ -3851,200 +4564,1127 @@ void Matrix::readRaw()
 }
 
 
-// tri-diagonalize a symmetric matrix.  The matrix will be destroyed and
-// the diagonal will be returned in d and off diagonal in e.   It uses
-// the Householder transformation
-// WARNING: ALLOCATES SPACE for d and e!!!
-void Matrix::tridiagonalize(double *&d, double *&e)
+// read a numeric matrix from a file in the same format as read().
+// The file is read through a large stdio buffer.
+void Matrix::read(std::string filename)
 {
-    d = new double [maxc];  // the diagonal elements
-    e = new double [maxc];  // the off-diagonal elements
+    const size_t chunk = 1<<20;
+    FILE *IN;
 
-    householder(m, maxc, d, e);
+    IN = fopen(filename.c_str(), "r");
+    if (IN==NULL) {
+        printf("ERROR(read): Trying to open file \"%s\" but failed.\n", filename.c_str());
+        exit(1);
+    }
+    setvbuf(IN, NULL, _IOFBF, chunk);
+
+    readAux(IN, NUM, false, NULL);
+    fclose(IN);
 }
 
 
-// compute the eigenvalues and eigenvectors of a SYMMETRIC matrix
+// read one field of a delimited file into field.  A field in double
+// quotes may hold the separator and newlines with "" for a quote, and
+// quoted says if it was quoted so "" can be told from nothing.  A
+// carriage return before a newline is dropped.  Returns the character
+// that ended the field: the separator, '\n' or EOF.  where names the
+// file for errors.
+static int readCsvField(FILE *IN, char separator, std::string &field, bool &quoted, int &line,
+                        const std::string &where)
+{
+    int ch, start;
+
+    field.clear();
+    ch = getc_unlocked(IN);
+    quoted = (ch=='"');
+    if (quoted) {
+        start = line;
+        for (;;) {
+            ch = getc_unlocked(IN);
+            if (ch==EOF) {
+                printf("ERROR(readCsv): the quoted field starting on line %d of \"%s\" has no closing quote\n", start, where.c_str());
+                exit(1);
+            }
+            if (ch=='"') {
+                ch = getc_unlocked(IN);
+                if (ch!='"') break;
+            }
+            if (ch=='\n') line++;
+            field += (char)ch;
+        }
+        while (ch!=separator && ch!='\n' && ch!=EOF) ch = getc_unlocked(IN);   // text after the closing quote
+    }
+    else {
+        while (ch!=separator && ch!='\n' && ch!=EOF) {
+            field += (char)ch;
+            ch = getc_unlocked(IN);
+        }
+    }
+    if (ch=='\n' && field.length()>0 && field[field.length()-1]=='\r') field.erase(field.length()-1);
+
+    return ch;
+}
+
+
+// read a delimited text file (comma separated by default, use '\t'
+// for TSV) in one pass into self.  schema gives the type of each
+// column of the file and every line must have that many fields.
+// NUMERIC fields are converted like read() does.  CATEGORICAL and
+// LABEL fields are added to syms (allocated if NULL and needed) and
+// the number stored, so all string columns share one map.  Blank lines
+// are skipped.  A line of just "" is not blank but one empty field.
+// If header the first line is column names and the names of the kept
+// columns in matrix order are put in colNames if given.  The filename
+// "" means stdin.  Returns syms.
+SymbolNumMap *Matrix::readCsv(std::string filename, const std::vector<ColumnType> &schema,
+                              SymbolNumMap *syms, std::vector<std::string> *colNames,
+                              char separator, bool header)
+{
+    const size_t chunk = 1<<20;
+    int numFields = schema.size();
+    std::vector<int> dest(numFields, -1);   // matrix column of each field or -1
+    std::string field, where;
+    int numOut, labels, strings, line, f, ch;
+    bool quoted;
+    char bad;
+    FILE *IN;
+
+    // where each column of the file goes
+    labels = strings = 0;
+    for (f=0; f<numFields; f++) {
+        if (schema[f]==LABEL) {
+            labels++;
+            dest[f] = 0;
+        }
+    }
+    if (labels>1) {
+        printf("ERROR(readCsv): the schema has %d LABEL columns but at most one is allowed\n", labels);
+        exit(1);
+    }
+    numOut = labels;
+    for (f=0; f<numFields; f++) {
+        if (schema[f]==NUMERIC || schema[f]==CATEGORICAL) dest[f] = numOut++;
+        if (schema[f]==CATEGORICAL || schema[f]==LABEL) strings++;
+    }
+    if (numOut==0) {
+        printf("ERROR(readCsv): the schema for file \"%s\" does not keep any columns\n", filename.c_str());
+        exit(1);
+    }
+    if (strings>0 && syms==NULL) syms = new SymbolNumMap("", 1000);
+
+    if (filename.length()>0) {
+        IN = fopen(filename.c_str(), "r");
+        if (IN==NULL) {
+            printf("ERROR(readCsv): Trying to open file \"%s\" but failed.\n", filename.c_str());
+            exit(1);
+        }
+        setvbuf(IN, NULL, _IOFBF, chunk);
+        where = filename;
+    }
+    else {
+        IN = stdin;
+        where = "stdin";
+    }
+
+    // the names of the columns
+    line = 1;
+    if (header) {
+        if (colNames) colNames->assign(numOut, "");
+        f = 0;
+        do {
+            ch = readCsvField(IN, separator, field, quoted, line, where);
+            if (f<numFields && dest[f]>=0 && colNames) (*colNames)[dest[f]] = field;
+            f++;
+        } while (ch==separator);
+        if (f!=numFields) {
+            printf("ERROR(readCsv): header line of \"%s\" has %d columns but the schema has %d\n", where.c_str(), f, numFields);
+            exit(1);
+        }
+        line++;
+    }
+
+    // the rows
+    MatrixBuilder rows(numOut, name);
+    std::vector<double> row(numOut);
+    for (;;) {
+        int start = line;
+
+        f = 0;
+        do {
+            ch = readCsvField(IN, separator, field, quoted, line, where);
+            if (f==0 && ch!=separator && field.length()==0 && !quoted) break;   // blank line or end of file
+            if (f>=numFields) {
+                printf("ERROR(readCsv): line %d of \"%s\" has more than the %d columns in the schema\n", start, where.c_str(), numFields);
+                exit(1);
+            }
+
+            if (schema[f]==NUMERIC) {
+                size_t first = field.find_first_not_of(" \t");
+                size_t last = field.find_last_not_of(" \t");
+
+                if (first==std::string::npos) {
+                    printf("ERROR(readCsv): line %d of \"%s\" has no number in column %d\n", start, where.c_str(), f);
+                    exit(1);
+                }
+                field = field.substr(first, last-first+1);
+                if (parseDouble(&field[0], field.length(), row[dest[f]], bad)!=1) {
+                    printf("ERROR(readCsv): invalid number in line %d column %d of \"%s\".  First character is '%c'\n", start, f, where.c_str(), bad);
+                    exit(1);
+                }
+            }
+            else if (schema[f]!=IGNORED) {
+                row[dest[f]] = syms->add(field);
+            }
+            f++;
+        } while (ch==separator);
+
+        if (f>0) {
+            if (f!=numFields) {
+                printf("ERROR(readCsv): line %d of \"%s\" has %d columns but the schema has %d\n", start, where.c_str(), f, numFields);
+                exit(1);
+            }
+            rows.appendRow(row.data());
+        }
+        if (ch==EOF) break;
+        line++;
+    }
+
+    if (IN!=stdin) fclose(IN);
+    rows.finalize(*this);
+
+    return syms;
+}
+
+
+// binary matrix files.  Layout (all header integers little endian):
 //
-// input:  A symmetric matrix (WARNING: this fact is NOT verified!)
-//         Input matrix is destroyed.
-// output: Returns a row matrix of eigen values and
-//         transforms the matrix into a matrix of eigenvectors (one vector in each row)
-//         in the same order as the eigenvalues.
-// NOTE: The matrix is NOT the set of eigen vectors in columns!
-// NOTE: The vectors are SORTED by decreasing magnitude of eigenvalue
-// NOTE: The vectors are normalized (norm of each vector is 1)
-// NOTE: The input matrix is destroyed
+//   magic      4 bytes  "MATB"
+//   version    uint32   1
+//   dtype      uint8    1 = 64 bit IEEE double (the only type so far)
+//   endian     uint8    byte order of the data: 1 little, 2 big
+//   flags      uint16   1 = column names follow, 2 = symbol table follows
+//   rows       uint64
+//   cols       uint64
+//   [column names: cols strings]
+//   [symbol table: int32 startNum, uint32 count, count strings for
+//    startNum...startNum+count-1 in order]
+//   padding    zero bytes so the data starts at a multiple of 8 bytes
+//   data       rows*cols doubles by row in the byte order given
+//              or compressed blocks if flag 4 is set (see below)
+//   checksum   uint64 of the header bytes and the data values
+//
+// A string is a uint32 length followed by that many bytes.  The data is
+// written in the byte order of the machine writing it and swapped on
+// read if needed.  The checksum is over the bit patterns of the values
+// so it is the same whatever the byte order.  Because the data is
+// aligned a file can be mapped straight into memory (see the mapped
+// Matrix constructor).
 
-// WARNING: allocates a row matrix of eigenvalues
+static const char binaryMagic[4] = {'M', 'A', 'T', 'B'};
+static const unsigned int binaryVersion = 1;
+static const int binaryDouble = 1;
+static const int binaryFlagColNames = 1;
+static const int binaryFlagSymbols = 2;
+static const int binaryFlagCompressed = 4;
 
-// quick insertion sort for the eigen values AND corresponding vectors
-// in DECREASING order of MAGNITUDE
-void isort(double a[], double *b[], int len)
+
+static bool hostLittleEndian()
 {
-    for (int i=1; i<len; i++) {
-        double aa, *bb;
-        int j;
+    unsigned int one = 1;
 
-        aa = a[i];
-        bb = b[i];
-        for (j = i-1; (j>=0) && (fabs(a[j])<fabs(aa)); j--) {
-            a[j+1] = a[j];
-            b[j+1] = b[j];
-        }
-        a[j+1] = aa;
-        b[j+1] = bb;
+    return *(unsigned char *)&one==1;
+}
+
+
+static inline unsigned long long byteSwap64(unsigned long long x)
+{
+    x = ((x & 0x00ff00ff00ff00ffULL)<<8) | ((x>>8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL)<<16) | ((x>>16) & 0x0000ffff0000ffffULL);
+    return (x<<32) | (x>>32);
+}
+
+
+// add one 64 bit word into a running checksum
+static inline unsigned long long checksumWord(unsigned long long h, unsigned long long w)
+{
+    h ^= w * 0x9E3779B97F4A7C15ULL;
+    h = (h<<31) | (h>>33);
+    return h * 0xC2B2AE3D27D4EB4FULL;
+}
+
+
+// add n doubles into a running checksum
+static inline unsigned long long checksumDoubles(unsigned long long h, const double *x, int n)
+{
+    for (int i=0; i<n; i++) {
+        unsigned long long w;
+
+        memcpy(&w, &x[i], sizeof(w));
+        h = checksumWord(h, w);
     }
+
+    return h;
 }
 
-// Destroys self by replacing self with EIGENVECTORS in rows.
-// Returns a new matrix (a row vector) with the EIGENVALUES in it.
-// Eigenvalues and vectors returned sorted from largest magnitude to smallest
-// WARNING: allocates new matrix for answer
-Matrix Matrix::eigenSystem()
+
+// add a run of bytes into a running checksum, 8 at a time little endian
+static unsigned long long checksumBytes(unsigned long long h, const std::vector<unsigned char> &bytes)
 {
-    assertDefined("eigenSystem");
-    assertSquare("eigenSystem");
+    size_t n = bytes.size();
 
-    Matrix values(1, maxc);   // allocates space for eigen values
+    for (size_t i=0; i<n; i+=8) {
+        unsigned long long w = 0;
 
-    {
-        double *d, *e;
+        for (size_t j=0; j<8 && i+j<n; j++) w |= (unsigned long long)bytes[i+j]<<(8*j);
+        h = checksumWord(h, w);
+    }
 
-        tridiagonalize(d, e);         // allocates space for 2 double arrays
-        eigen(d, e, maxc, m);         // returns eigen values in d
+    return checksumWord(h, n);
+}
 
-        delete values.m[0];           // save the eigen values from above routines
-        values.m[0] = d;
 
-        delete [] e;
+static void putBinaryInt(std::vector<unsigned char> &bytes, unsigned long long x, int size)
+{
+    for (int i=0; i<size; i++) {
+        bytes.push_back((unsigned char)x);
+        x >>= 8;
     }
+}
 
-    transposeSelf();              // result was returned in columns so put it in rows
-    isort(values.m[0], m, maxc);  // sort both eigenvalues and vectors in rows so vector with max eigenvalue is first
-    values.defined = true;        // mark eigen value matrix as defined
 
-    return values;
+static void putBinaryString(std::vector<unsigned char> &bytes, const std::string &str)
+{
+    putBinaryInt(bytes, str.length(), 4);
+    bytes.insert(bytes.end(), str.begin(), str.end());
 }
 
 
-// // // // // // // // // // // // // // // // // // // // // // // // // // // // // //
-//
-// The following routines are from "Numerical Recipes in C"
-//
-// REF: Eigenvalue solvers, tred2 (householder) and tqli (eigen), from
-// "Numerical Recipes in C" (Cambridge Univ. Press) by W.H. Press,
-// S.A. Teukolsky, W.T. Vetterling, and B.P. Flannery. Translated from
-// 1 based array (originally from FORTRAN) by Robert Heckendorn,
-// University of Idaho
-//
-// Householder reduction of a real, symmetric matrix a[0..n-1][0..n-1] to a
-// symmetric tridiagonal matrix.
+// reads header fields from a binary matrix file keeping a copy of every
+// byte read so the checksum can be checked at the end
+struct BinaryReader {
+    FILE *IN;
+    std::string filename;
+    std::vector<unsigned char> bytes;
+
+    void get(void *x, size_t size, const char *what) {
+        if (fread(x, 1, size, IN)!=size) {
+            printf("ERROR(readBinary): file \"%s\" ended while reading the %s\n", filename.c_str(), what);
+            exit(1);
+        }
+        bytes.insert(bytes.end(), (unsigned char *)x, (unsigned char *)x + size);
+    }
+
+    unsigned long long getInt(int size, const char *what) {
+        unsigned char buffer[8];
+        unsigned long long x;
+
+        get(buffer, size, what);
+        x = 0;
+        for (int i=size-1; i>=0; i--) x = (x<<8) | buffer[i];
+        return x;
+    }
+
+    std::string getString(const char *what) {
+        unsigned long long len = getInt(4, what);
+        std::string str(len, '\0');
+
+        if (len>0) get(&str[0], len, what);
+        return str;
+    }
+};
+
+
+// Compressed data.  With flag 4 the values are written as a run of
+// blocks of up to binaryBlockValues doubles each:
 //
-// On output, a is replaced by the orthogonal matrix Q effecting the
-// transformation. d[0..n-1] returns the diagonal elements of the tridiagonal matrix,
-// and e[0..n-1] the off-diagonal elements, with e[0]=0. Several statements, as noted
-// in comments, can be omitted if only eigenvalues are to be found, in which case a
-// contains no useful information on output. Otherwise they are to be included.
+//   count      uint32   number of values in the block
+//   mode       uint8    0 stored, 1 shuffled, 2 delta and shuffled
+//   size       uint32   number of bytes that follow
+//   bytes
 //
-#define SIGN(a, b) ((b) >= 0.0 ? fabs(a) : -fabs(a))
-static void householder(double **a, int n, double d[], double e[])
+// Mode 0 is the 64 bit patterns of the values little endian.  Mode 1
+// byte shuffles the patterns (all the lowest bytes, then all the next
+// bytes, ...) and mode 2 first replaces each pattern by its difference
+// from the one before it.  Doubles holding small integers or a few
+// repeated values have long runs of equal bytes once shuffled and
+// smooth image rows have small differences, which the LZ stage below
+// then squeezes out.  The writer keeps whichever mode is smallest so
+// random data costs only the block headers.  A reader decodes one
+// block at a time so memory use does not grow with the matrix.
+
+static const int binaryBlockValues = 8192;
+static const int binaryStored = 0;
+static const int binaryShuffled = 1;
+static const int binaryDelta = 2;
+
+
+static inline unsigned int lzRead32(const unsigned char *p)
 {
-    int l, k, j, i;
-    double scale, hh, h, g, f;
+    unsigned int x;
 
-    for (i=n-1; i>=1; i--) {
-        l=i-1;
-        h=scale=0.0;
-        if (l > 0) {
-            for (k=0; k<=l; k++) {
-                scale += fabs(a[i][k]);
-            }
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
 
-            if (scale == 0.0) {             // Skip transformation.
-                e[i]=a[i][l];
-            }
-            else {
-                for (k=0; k<=l; k++) {
-                    a[i][k] /= scale;       // Use scaled a's for transformation.
-                    h += a[i][k]*a[i][k];   // Form sigma in h.
-                }
-                f=a[i][l];
-                g=(f >= 0.0 ? -sqrt(h) : sqrt(h));
-                e[i]=scale*g;
-                h -= f*g;                   // Now h is equation (11.2.4).
-                a[i][l]=f-g;                // Store u in the ith row of a.
-                f=0.0;
-                for (j=0; j<=l; j++) {
-                    // Next statement can be omitted if eigenvectors not wanted
-                    a[j][i]=a[i][j]/h;      // Store u/H in ith column of a.
 
-                    g=0.0;                  // Form an element of A.u in g.
-                    for (k=0; k<=j; k++) {
-                        g += a[j][k]*a[i][k];
-                    }
-                    for (k=j+1; k<=l; k++) {
-                        g += a[k][j]*a[i][k];
-                    }
+// a small LZ77 in the style of LZ4.  The output is a list of sequences
+// each a token byte (literal count in the high 4 bits, match length-4
+// in the low 4 bits, 15 meaning more length bytes follow, each 255
+// meaning yet more), the literals, then a 2 byte little endian offset
+// back to the match and any extra match length bytes.  The last
+// sequence is literals only.  Matches may overlap the bytes they
+// produce so a run of one byte is a single short match.
+// dst needs room for n + n/255 + 16 bytes.  Returns the size used.
+static size_t lzCompress(const unsigned char *src, size_t n, unsigned char *dst)
+{
+    const int hashBits = 13;
+    const size_t minMatch = 4;
+    std::vector<int> table(1<<hashBits, -1);
+    unsigned char *out = dst;
+    size_t i, anchor;
 
-                    e[j]=g/h;               // Form element of p in temporarily unused element of e.
-                    f += e[j]*a[i][j];
-                }
-                hh=f/(h+h);                 // Form K, equation (11.2.11).
+    // literal run and match length both use the same extension scheme
+    auto putLength = [&out](size_t len) {
+        while (len>=255) { *out++ = 255; len -= 255; }
+        *out++ = (unsigned char)len;
+    };
 
-                // Form q and store in e overwriting p.
-                for (j=0; j<=l; j++) {
-                    f=a[i][j];
-                    e[j]=g=e[j]-hh*f;
+    i = anchor = 0;
+    while (n>=minMatch+8 && i+minMatch+8<=n) {
+        unsigned int h = (lzRead32(src+i) * 2654435761U) >> (32-hashBits);
+        int cand = table[h];
 
-                    // Reduce a, equation (11.2.13).
-                    for (k=0; k<=j; k++) {
-                        a[j][k] -= (f*e[k] + g*a[i][k]);
-                    }
-                }
-            }
-        }
-        else {
-            e[i]=a[i][l];
+        table[h] = i;
+        if (cand<0 || i-cand>65535 || lzRead32(src+cand)!=lzRead32(src+i)) {
+            i += 1 + ((i-anchor)>>6);    // skip faster through data that does not match
+            continue;
         }
-        d[i]=h;
+
+        // extend the match (the last 8 bytes are always left as literals)
+        size_t len = minMatch;
+        while (i+len<n-8 && src[cand+len]==src[i+len]) len++;
+
+        size_t lit = i-anchor;
+        unsigned char *token = out++;
+        *token = (unsigned char)(((lit<15 ? lit : 15)<<4) | (len-minMatch<15 ? len-minMatch : 15));
+        if (lit>=15) putLength(lit-15);
+        memcpy(out, src+anchor, lit);
+        out += lit;
+        *out++ = (unsigned char)(i-cand);
+        *out++ = (unsigned char)((i-cand)>>8);
+        if (len-minMatch>=15) putLength(len-minMatch-15);
+
+        i += len;
+        anchor = i;
     }
 
-    // Next statement can be omitted if eigenvectors not wanted
-    d[0]=0.0;
-    e[0]=0.0;
+    // the rest as literals
+    size_t lit = n-anchor;
+    *out++ = (unsigned char)((lit<15 ? lit : 15)<<4);
+    if (lit>=15) putLength(lit-15);
+    memcpy(out, src+anchor, lit);
+    out += lit;
 
-    // Contents of this loop can be omitted if eigenvectors not
-    //   wanted except for statement d[i]=a[i][i];
+    return out-dst;
+}
 
-    // Begin accumulation of transformation matrices.
-    for (i=0; i<n; i++) {
-        l=i-1;
-        if (d[i]) {                        // This block skipped when i=0.
-            for (j=0; j<=l; j++) {
-                // Use u and u/H stored in a to form P.Q.
-                g=0.0;
-                for (k=0; k<=l; k++) {
-                    g += a[i][k]*a[k][j];
-                }
-                for (k=0; k<=l; k++) {
-                    a[k][j] -= g*a[k][i];
-                }
-            }
-        }
-        d[i]=a[i][i];                       // This statement remains.
-        a[i][i]=1.0;                        // Reset row and column of a to identity matrix for next iteration.
-        for (j=0; j<=l; j++) {
-            a[j][i]=a[i][j]=0.0;
+
+// undo lzCompress of size bytes in src into exactly n bytes of dst.
+// Returns false if the data is not a valid encoding of n bytes.
+static bool lzDecompress(const unsigned char *src, size_t size, unsigned char *dst, size_t n)
+{
+    const unsigned char *in = src, *inEnd = src+size;
+    unsigned char *out = dst, *outEnd = dst+n;
+
+    // read the rest of a length whose 4 bit part was 15
+    auto getLength = [&in, inEnd](size_t &len) {
+        unsigned char b;
+
+        do {
+            if (in>=inEnd) return false;
+            b = *in++;
+            len += b;
+        } while (b==255);
+        return true;
+    };
+
+    for (;;) {
+        if (in>=inEnd) return false;
+        unsigned char token = *in++;
+        size_t lit = token>>4;
+
+        if (lit==15 && !getLength(lit)) return false;
+        if (lit>size_t(inEnd-in) || lit>size_t(outEnd-out)) return false;
+        memcpy(out, in, lit);
+        in += lit;
+        out += lit;
+        if (in==inEnd) break;     // last sequence
+
+        if (inEnd-in<2) return false;
+        size_t offset = in[0] | (in[1]<<8);
+        in += 2;
+        size_t len = token & 15;
+        if (len==15 && !getLength(len)) return false;
+        len += 4;
+        if (offset==0 || offset>size_t(out-dst) || len>size_t(outEnd-out)) return false;
+
+        // an overlapping match repeats its first offset bytes.  Copy the
+        // pattern in pieces that double in size so each copy is disjoint.
+        const unsigned char *match = out-offset;
+        for (size_t done=0; done<len; ) {
+            size_t piece = std::min(len-done, offset+done);
+
+            memcpy(out+done, match, piece);
+            done += piece;
         }
+        out += len;
     }
+
+    return out==outEnd;
 }
 
 
-// Compute the eigen values and vectors of a symmetric tridiagonal matrix
-//
-// QL algorithm with implicit shifts, to determine the eigenvalues and eigenvectors
-// of a real, symmetric, tridiagonal matrix, or of a real, symmetric matrix
+// encode n doubles as a compressed block (header included) appended to
+// block
+static void encodeBlock(const double *x, int n, std::vector<unsigned char> &block)
+{
+    std::vector<unsigned long long> word(n);
+    std::vector<unsigned char> shuffled(8*size_t(n));
+    std::vector<unsigned char> packed[2];
+    int mode, best;
+
+    memcpy(word.data(), x, n*sizeof(double));
+    best = binaryStored;
+    for (mode=binaryShuffled; mode<=binaryDelta; mode++) {
+        std::vector<unsigned char> &out = packed[mode-binaryShuffled];
+
+        if (mode==binaryDelta) {
+            for (int i=n-1; i>0; i--) word[i] -= word[i-1];
+        }
+        for (int b=0; b<8; b++) {
+            for (int i=0; i<n; i++) shuffled[size_t(b)*n+i] = (unsigned char)(word[i]>>(8*b));
+        }
+        out.resize(shuffled.size() + shuffled.size()/255 + 16);
+        out.resize(lzCompress(shuffled.data(), shuffled.size(), out.data()));
+        if (out.size()<8*size_t(n) && (best==binaryStored || out.size()<packed[best-binaryShuffled].size())) best = mode;
+    }
+
+    putBinaryInt(block, n, 4);
+    putBinaryInt(block, best, 1);
+    if (best==binaryStored) {
+        putBinaryInt(block, 8*size_t(n), 4);
+        for (int i=0; i<n; i++) {
+            unsigned long long w;
+
+            memcpy(&w, &x[i], sizeof(w));
+            putBinaryInt(block, w, 8);
+        }
+    }
+    else {
+        std::vector<unsigned char> &out = packed[best-binaryShuffled];
+
+        putBinaryInt(block, out.size(), 4);
+        block.insert(block.end(), out.begin(), out.end());
+    }
+}
+
+
+// read the next compressed block of in into x (room for
+// binaryBlockValues).  Returns the number of values in it.  packed and
+// shuffled are scratch space kept between calls.
+static int decodeBlock(BinaryReader &in, double *x, std::vector<unsigned char> &packed,
+                       std::vector<unsigned char> &shuffled)
+{
+    unsigned long long n, size;
+    int mode;
+
+    n = in.getInt(4, "block header");
+    mode = in.getInt(1, "block header");
+    size = in.getInt(4, "block header");
+    in.bytes.clear();    // the checksum is over the values not the blocks
+    if (n==0 || n>(unsigned long long)binaryBlockValues || mode>binaryDelta ||
+        size>8*n + 8*n/255 + 16) {
+        printf("ERROR(readBinary): file \"%s\" has a bad compressed block header\n", in.filename.c_str());
+        exit(1);
+    }
+
+    packed.resize(size);
+    if (fread(packed.data(), 1, size, in.IN)!=size) {
+        printf("ERROR(readBinary): file \"%s\" ended while reading a compressed block\n", in.filename.c_str());
+        exit(1);
+    }
+
+    if (mode==binaryStored) {
+        if (size!=8*n) {
+            printf("ERROR(readBinary): file \"%s\" has a stored block of the wrong size\n", in.filename.c_str());
+            exit(1);
+        }
+        for (unsigned long long i=0; i<n; i++) {
+            unsigned long long w = 0;
+
+            for (int b=7; b>=0; b--) w = (w<<8) | packed[8*i+b];
+            memcpy(&x[i], &w, sizeof(w));
+        }
+        return n;
+    }
+
+    shuffled.resize(8*n);
+    if (!lzDecompress(packed.data(), size, shuffled.data(), 8*n)) {
+        printf("ERROR(readBinary): file \"%s\" has a corrupted compressed block\n", in.filename.c_str());
+        exit(1);
+    }
+    const unsigned char *plane = shuffled.data();
+    unsigned long long prev = 0;
+    for (unsigned long long i=0; i<n; i++) {
+        unsigned long long w = 0;
+
+        for (int b=7; b>=0; b--) w = (w<<8) | plane[b*n+i];
+        if (mode==binaryDelta) w = prev += w;
+        memcpy(&x[i], &w, sizeof(w));
+    }
+
+    return n;
+}
+
+
+// write self in the binary matrix file format.  If colNames is given it
+// must have one name per column.  If syms is given its table is saved
+// so string valued entries can be turned back into strings after
+// readBinary.  If compress the data is written as compressed blocks.
+void Matrix::writeBinary(std::string filename, const std::vector<std::string> *colNames,
+                         const SymbolNumMap *syms, bool compress) const
+{
+    std::vector<unsigned char> header;
+    unsigned long long checksum;
+    FILE *OUT;
+    int flags;
+
+    assertDefined("writeBinary");
+    if (colNames && int(colNames->size())!=maxc) {
+        printf("ERROR(writeBinary): %d column names given for a matrix with %d columns\n",
+               int(colNames->size()), maxc);
+        exit(1);
+    }
+
+    // build the header in memory
+    flags = (colNames ? binaryFlagColNames : 0) | (syms ? binaryFlagSymbols : 0) |
+            (compress ? binaryFlagCompressed : 0);
+    header.insert(header.end(), binaryMagic, binaryMagic+4);
+    putBinaryInt(header, binaryVersion, 4);
+    putBinaryInt(header, binaryDouble, 1);
+    putBinaryInt(header, hostLittleEndian() ? 1 : 2, 1);
+    putBinaryInt(header, flags, 2);
+    putBinaryInt(header, maxr, 8);
+    putBinaryInt(header, maxc, 8);
+    if (colNames) {
+        for (int c=0; c<maxc; c++) putBinaryString(header, (*colNames)[c]);
+    }
+    if (syms) {
+        putBinaryInt(header, (unsigned int)syms->startNum, 4);
+        putBinaryInt(header, syms->next-syms->startNum, 4);
+        for (int n=syms->startNum; n<syms->next; n++) putBinaryString(header, syms->getStrDefault(n));
+    }
+    while (header.size()%8!=0) header.push_back(0);
+
+    if (filename.length()>0) {
+        OUT = fopen(filename.c_str(), "wb");
+        if (OUT==NULL) {
+            printf("ERROR(writeBinary): Trying to open file \"%s\" but failed.\n", filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        OUT = stdout;
+    }
+
+    // header, then the rows as they sit in memory
+    checksum = checksumBytes(0, header);
+    fwrite(header.data(), 1, header.size(), OUT);
+    if (!compress) {
+        for (int r=0; r<maxr; r++) {
+            checksum = checksumDoubles(checksum, m[r], maxc);
+            fwrite(m[r], sizeof(double), maxc, OUT);
+        }
+    }
+
+    // or gather the rows into blocks and compress them
+    else {
+        std::vector<double> values(binaryBlockValues);
+        std::vector<unsigned char> block;
+        int n = 0;
+
+        for (int r=0; r<maxr; r++) {
+            checksum = checksumDoubles(checksum, m[r], maxc);
+            for (int c=0; c<maxc; ) {
+                int take = std::min(maxc-c, binaryBlockValues-n);
+
+                memcpy(&values[n], &m[r][c], take*sizeof(double));
+                n += take;
+                c += take;
+                if (n==binaryBlockValues) {
+                    block.clear();
+                    encodeBlock(values.data(), n, block);
+                    fwrite(block.data(), 1, block.size(), OUT);
+                    n = 0;
+                }
+            }
+        }
+        if (n>0) {
+            block.clear();
+            encodeBlock(values.data(), n, block);
+            fwrite(block.data(), 1, block.size(), OUT);
+        }
+    }
+
+    std::vector<unsigned char> tail;
+    putBinaryInt(tail, checksum, 8);
+    fwrite(tail.data(), 1, tail.size(), OUT);
+
+    if (ferror(OUT)) {
+        printf("ERROR(writeBinary): write to file \"%s\" failed\n", filename.c_str());
+        exit(1);
+    }
+    if (OUT==stdout) fflush(OUT);
+    else fclose(OUT);
+}
+
+
+// read the header of a binary matrix file from IN up to the start of
+// the data.  Gives the size, whether the data must be byte swapped or
+// is compressed and the checksum so far.  Column names and the symbol table are handled
+// as described for readBinary.
+SymbolNumMap *Matrix::readBinaryHeader(FILE *IN, std::string filename, int &rows, int &cols, bool &swap,
+                                       bool &compressed, unsigned long long &checksum, std::vector<std::string> *colNames,
+                                       SymbolNumMap *syms)
+{
+    BinaryReader in;
+    unsigned long long r, c;
+    unsigned int version;
+    int dtype, endian, flags;
+    char magic[4];
+
+    in.IN = IN;
+    in.filename = filename;
+
+    // fixed part of the header
+    in.get(magic, 4, "magic number");
+    if (memcmp(magic, binaryMagic, 4)!=0) {
+        printf("ERROR(readBinary): file \"%s\" is not a binary matrix file (bad magic number)\n", filename.c_str());
+        exit(1);
+    }
+    version = in.getInt(4, "version");
+    if (version!=binaryVersion) {
+        printf("ERROR(readBinary): file \"%s\" is binary matrix format version %u but only version %u is supported\n",
+               filename.c_str(), version, binaryVersion);
+        exit(1);
+    }
+    dtype = in.getInt(1, "data type");
+    if (dtype!=binaryDouble) {
+        printf("ERROR(readBinary): file \"%s\" has unsupported data type %d\n", filename.c_str(), dtype);
+        exit(1);
+    }
+    endian = in.getInt(1, "byte order");
+    if (endian!=1 && endian!=2) {
+        printf("ERROR(readBinary): file \"%s\" has unknown byte order %d\n", filename.c_str(), endian);
+        exit(1);
+    }
+    swap = (endian==1)!=hostLittleEndian();
+    flags = in.getInt(2, "flags");
+    if (flags & ~(binaryFlagColNames | binaryFlagSymbols | binaryFlagCompressed)) {
+        printf("ERROR(readBinary): file \"%s\" has unknown flags %d\n", filename.c_str(), flags);
+        exit(1);
+    }
+    compressed = (flags & binaryFlagCompressed)!=0;
+    r = in.getInt(8, "number of rows");
+    c = in.getInt(8, "number of columns");
+    if (r>0x7fffffffULL || c>0x7fffffffULL) {
+        printf("ERROR(readBinary): file \"%s\" claims a matrix of size %llu X %llu\n", filename.c_str(), r, c);
+        exit(1);
+    }
+    rows = r;
+    cols = c;
+
+    // optional parts of the header
+    if (flags & binaryFlagColNames) {
+        if (colNames) colNames->clear();
+        for (int i=0; i<cols; i++) {
+            std::string colName = in.getString("column names");
+
+            if (colNames) colNames->push_back(colName);
+        }
+    }
+    if (flags & binaryFlagSymbols) {
+        int startNum = (int)in.getInt(4, "symbol table");
+        unsigned long long count = in.getInt(4, "symbol table");
+
+        if (syms==NULL) syms = new SymbolNumMap("", startNum);
+        syms->clear();
+        syms->startNum = startNum;
+        syms->next = startNum;
+        for (unsigned long long i=0; i<count; i++) syms->add(in.getString("symbol table"));
+    }
+    while (in.bytes.size()%8!=0) {
+        char pad;
+
+        in.get(&pad, 1, "header padding");
+    }
+    checksum = checksumBytes(0, in.bytes);
+
+    return syms;
+}
+
+
+// read a matrix written by writeBinary into self, resizing as needed.
+// If the file has column names and colNames is given they are put
+// there.  If the file has a symbol table it is put in syms (which is
+// cleared first) or in a newly allocated SymbolNumMap if syms is NULL,
+// and that map is returned.  Otherwise syms is returned unchanged.
+// Compressed files are decoded a block at a time.
+SymbolNumMap *Matrix::readBinary(std::string filename, std::vector<std::string> *colNames,
+                                 SymbolNumMap *syms)
+{
+    BinaryReader in;
+    unsigned long long checksum;
+    int rows, cols;
+    bool swap, compressed;
+
+    in.filename = filename;
+    if (filename.length()>0) {
+        in.IN = fopen(filename.c_str(), "rb");
+        if (in.IN==NULL) {
+            printf("ERROR(readBinary): Trying to open file \"%s\" but failed.\n", filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        in.IN = stdin;
+        in.filename = "stdin";
+    }
+
+    syms = readBinaryHeader(in.IN, in.filename, rows, cols, swap, compressed, checksum, colNames, syms);
+
+    // the data
+    if (maxr!=rows || maxc!=cols) reallocate(rows, cols, name);
+    if (compressed) {
+        std::vector<double> values(binaryBlockValues);
+        std::vector<unsigned char> packed, shuffled;
+        int n = 0, next = 0;
+
+        for (int r=0; r<maxr; r++) {
+            for (int c=0; c<maxc; ) {
+                if (next==n) {
+                    n = decodeBlock(in, values.data(), packed, shuffled);
+                    next = 0;
+                }
+                int take = std::min(maxc-c, n-next);
+
+                memcpy(&m[r][c], &values[next], take*sizeof(double));
+                next += take;
+                c += take;
+            }
+            checksum = checksumDoubles(checksum, m[r], maxc);
+        }
+        if (next!=n) {
+            printf("ERROR(readBinary): file \"%s\" has more compressed data than the matrix holds\n", in.filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        for (int r=0; r<maxr; r++) {
+            if (fread(m[r], sizeof(double), maxc, in.IN)!=size_t(maxc)) {
+                printf("ERROR(readBinary): file \"%s\" ended while reading row %d of %d\n", in.filename.c_str(), r, maxr);
+                exit(1);
+            }
+            if (swap) {
+                for (int c=0; c<maxc; c++) {
+                    unsigned long long w;
+
+                    memcpy(&w, &m[r][c], sizeof(w));
+                    w = byteSwap64(w);
+                    memcpy(&m[r][c], &w, sizeof(w));
+                }
+            }
+            checksum = checksumDoubles(checksum, m[r], maxc);
+        }
+    }
+
+    if (in.getInt(8, "checksum")!=checksum) {
+        printf("ERROR(readBinary): checksum does not match in file \"%s\" so the file is corrupted\n", in.filename.c_str());
+        exit(1);
+    }
+
+    if (in.IN!=stdin) fclose(in.IN);
+    defined = true;
+
+    return syms;
+}
+
+
+// map a binary matrix file (see writeBinary) into memory.
+// The rows point straight into the mapped file so nothing is copied
+// and pages are read on demand and shared with every other process
+// mapping the same file.  access is passed on to madvise as a hint.
+// The data must be in this machine's byte order.  The checksum is not
+// checked since that would read the whole file (use readBinary for
+// that).  The file is never changed: the mapping is copy on write so
+// storing into an element gives this process its own copy of that
+// page.  Assigning to or reading into the matrix (see reallocate)
+// drops the mapping and uses ordinary memory.  It cannot be widened
+// or lengthened.
+Matrix::Matrix(std::string filename, MapAccess access, std::string namex)
+{
+    unsigned long long checksum;
+    int rows, cols, fd;
+    long dataStart;
+    bool swap, compressed;
+    struct stat info;
+    SymbolNumMap *syms;
+    FILE *IN;
+    void *addr;
+
+    allocate(-1, -1, namex);
+
+    IN = fopen(filename.c_str(), "rb");
+    if (IN==NULL) {
+        printf("ERROR(Matrix mapped): Trying to open file \"%s\" but failed.\n", filename.c_str());
+        exit(1);
+    }
+    syms = readBinaryHeader(IN, filename, rows, cols, swap, compressed, checksum, NULL, NULL);
+    delete syms;   // a symbol table in the file is not kept
+    dataStart = ftell(IN);
+    fclose(IN);
+    if (swap) {
+        printf("ERROR(Matrix mapped): file \"%s\" was written with the other byte order.  Use readBinary.\n", filename.c_str());
+        exit(1);
+    }
+    if (compressed) {
+        printf("ERROR(Matrix mapped): file \"%s\" is compressed.  Use readBinary.\n", filename.c_str());
+        exit(1);
+    }
+
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd<0 || fstat(fd, &info)!=0) {
+        printf("ERROR(Matrix mapped): Trying to open file \"%s\" but failed.\n", filename.c_str());
+        exit(1);
+    }
+    if ((unsigned long long)info.st_size < dataStart + (unsigned long long)rows*cols*sizeof(double) + 8) {
+        printf("ERROR(Matrix mapped): file \"%s\" is too short for a %d X %d matrix\n", filename.c_str(), rows, cols);
+        exit(1);
+    }
+
+    addr = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr==MAP_FAILED) {
+        printf("ERROR(Matrix mapped): unable to map file \"%s\" into memory\n", filename.c_str());
+        exit(1);
+    }
+    madvise(addr, info.st_size, access==SEQUENTIALACCESS ? MADV_SEQUENTIAL :
+                                 access==RANDOMACCESS ? MADV_RANDOM : MADV_NORMAL);
+
+    maxr = rows;
+    maxc = cols;
+    mapped = addr;
+    mappedSize = info.st_size;
+    m = new double * [maxr];
+    for (int r=0; r<maxr; r++) m[r] = (double *)((char *)addr + dataStart) + (size_t)r*maxc;
+    defined = true;
+}
+
+
+// tri-diagonalize a symmetric matrix.  The matrix will be destroyed and
+// the diagonal will be returned in d and off diagonal in e.   It uses
+// the Householder transformation
+// WARNING: ALLOCATES SPACE for d and e!!!
+void Matrix::tridiagonalize(double *&d, double *&e)
+{
+    d = new double [maxc];  // the diagonal elements
+    e = new double [maxc];  // the off-diagonal elements
+
+    householder(m, maxc, d, e);
+}
+
+
+// compute the eigenvalues and eigenvectors of a SYMMETRIC matrix
+//
+// input:  A symmetric matrix (WARNING: this fact is NOT verified!)
+//         Input matrix is destroyed.
+// output: Returns a row matrix of eigen values and
+//         transforms the matrix into a matrix of eigenvectors (one vector in each row)
+//         in the same order as the eigenvalues.
+// NOTE: The matrix is NOT the set of eigen vectors in columns!
+// NOTE: The vectors are SORTED by decreasing magnitude of eigenvalue
+// NOTE: The vectors are normalized (norm of each vector is 1)
+// NOTE: The input matrix is destroyed
+
+// WARNING: allocates a row matrix of eigenvalues
+
+// quick insertion sort for the eigen values AND corresponding vectors
+// in DECREASING order of MAGNITUDE
+void isort(double a[], double *b[], int len)
+{
+    for (int i=1; i<len; i++) {
+        double aa, *bb;
+        int j;
+
+        aa = a[i];
+        bb = b[i];
+        for (j = i-1; (j>=0) && (fabs(a[j])<fabs(aa)); j--) {
+            a[j+1] = a[j];
+            b[j+1] = b[j];
+        }
+        a[j+1] = aa;
+        b[j+1] = bb;
+    }
+}
+
+// Destroys self by replacing self with EIGENVECTORS in rows.
+// Returns a new matrix (a row vector) with the EIGENVALUES in it.
+// Eigenvalues and vectors returned sorted from largest magnitude to smallest
+// WARNING: allocates new matrix for answer
+Matrix Matrix::eigenSystem()
+{
+    assertDefined("eigenSystem");
+    assertSquare("eigenSystem");
+
+    Matrix values(1, maxc);   // allocates space for eigen values
+
+    {
+        double *d, *e;
+
+        tridiagonalize(d, e);         // allocates space for 2 double arrays
+        eigen(d, e, maxc, m);         // returns eigen values in d
+
+        delete values.m[0];           // save the eigen values from above routines
+        values.m[0] = d;
+
+        delete [] e;
+    }
+
+    transposeSelf();              // result was returned in columns so put it in rows
+    isort(values.m[0], m, maxc);  // sort both eigenvalues and vectors in rows so vector with max eigenvalue is first
+    values.defined = true;        // mark eigen value matrix as defined
+
+    return values;
+}
+
+
+// // // // // // // // // // // // // // // // // // // // // // // // // // // // // //
+//
+// The following routines are from "Numerical Recipes in C"
+//
+// REF: Eigenvalue solvers, tred2 (householder) and tqli (eigen), from
+// "Numerical Recipes in C" (Cambridge Univ. Press) by W.H. Press,
+// S.A. Teukolsky, W.T. Vetterling, and B.P. Flannery. Translated from
+// 1 based array (originally from FORTRAN) by Robert Heckendorn,
+// University of Idaho
+//
+// Householder reduction of a real, symmetric matrix a[0..n-1][0..n-1] to a
+// symmetric tridiagonal matrix.
+//
+// On output, a is replaced by the orthogonal matrix Q effecting the
+// transformation. d[0..n-1] returns the diagonal elements of the tridiagonal matrix,
+// and e[0..n-1] the off-diagonal elements, with e[0]=0. Several statements, as noted
+// in comments, can be omitted if only eigenvalues are to be found, in which case a
+// contains no useful information on output. Otherwise they are to be included.
+//
+#define SIGN(a, b) ((b) >= 0.0 ? fabs(a) : -fabs(a))
+static void householder(double **a, int n, double d[], double e[])
+{
+    int l, k, j, i;
+    double scale, hh, h, g, f;
+
+    for (i=n-1; i>=1; i--) {
+        l=i-1;
+        h=scale=0.0;
+        if (l > 0) {
+            for (k=0; k<=l; k++) {
+                scale += fabs(a[i][k]);
+            }
+
+            if (scale == 0.0) {             // Skip transformation.
+                e[i]=a[i][l];
+            }
+            else {
+                for (k=0; k<=l; k++) {
+                    a[i][k] /= scale;       // Use scaled a's for transformation.
+                    h += a[i][k]*a[i][k];   // Form sigma in h.
+                }
+                f=a[i][l];
+                g=(f >= 0.0 ? -sqrt(h) : sqrt(h));
+                e[i]=scale*g;
+                h -= f*g;                   // Now h is equation (11.2.4).
+                a[i][l]=f-g;                // Store u in the ith row of a.
+                f=0.0;
+                for (j=0; j<=l; j++) {
+                    // Next statement can be omitted if eigenvectors not wanted
+                    a[j][i]=a[i][j]/h;      // Store u/H in ith column of a.
+
+                    g=0.0;                  // Form an element of A.u in g.
+                    for (k=0; k<=j; k++) {
+                        g += a[j][k]*a[i][k];
+                    }
+                    for (k=j+1; k<=l; k++) {
+                        g += a[k][j]*a[i][k];
+                    }
+
+                    e[j]=g/h;               // Form element of p in temporarily unused element of e.
+                    f += e[j]*a[i][j];
+                }
+                hh=f/(h+h);                 // Form K, equation (11.2.11).
+
+                // Form q and store in e overwriting p.
+                for (j=0; j<=l; j++) {
+                    f=a[i][j];
+                    e[j]=g=e[j]-hh*f;
+
+                    // Reduce a, equation (11.2.13).
+                    for (k=0; k<=j; k++) {
+                        a[j][k] -= (f*e[k] + g*a[i][k]);
+                    }
+                }
+            }
+        }
+        else {
+            e[i]=a[i][l];
+        }
+        d[i]=h;
+    }
+
+    // Next statement can be omitted if eigenvectors not wanted
+    d[0]=0.0;
+    e[0]=0.0;
+
+    // Contents of this loop can be omitted if eigenvectors not
+    //   wanted except for statement d[i]=a[i][i];
+
+    // Begin accumulation of transformation matrices.
+    for (i=0; i<n; i++) {
+        l=i-1;
+        if (d[i]) {                        // This block skipped when i=0.
+            for (j=0; j<=l; j++) {
+                // Use u and u/H stored in a to form P.Q.
+                g=0.0;
+                for (k=0; k<=l; k++) {
+                    g += a[i][k]*a[k][j];
+                }
+                for (k=0; k<=l; k++) {
+                    a[k][j] -= g*a[k][i];
+                }
+            }
+        }
+        d[i]=a[i][i];                       // This statement remains.
+        a[i][i]=1.0;                        // Reset row and column of a to identity matrix for next iteration.
+        for (j=0; j<=l; j++) {
+            a[j][i]=a[i][j]=0.0;
+        }
+    }
+}
+
+
+// Compute the eigen values and vectors of a symmetric tridiagonal matrix
+//
+// QL algorithm with implicit shifts, to determine the eigenvalues and eigenvectors
+// of a real, symmetric, tridiagonal matrix, or of a real, symmetric matrix
 // previously reduced by householder sec. 11.2. On input, d[0..n-1] contains the diagonal
 // elements of the tridiagonal matrix. On output, it returns the eigenvalues. The
 // vector e[0..n-1] inputs the subdiagonal elements of the tridiagonal matrix, with
@@ -4055,812 +5695,3705 @@ static void householder(double **a, int n, double d[], double e[])
 // are required, then z is input as the matrix output by householder. In either case,
 // the kth column of z returns the normalized eigenvector corresponding to d[k].
 //
-// input: d - diagonal of symmetric tridiagonal matrix
-//        e - offdiagonal of symmetric tridiagonal matrix
-//        z - identity if you want eigensystem of symmetric tridiagonal matrix
-//          - OR the householder reduction of a symmetric matrix
-// output: d - eigenvalues
-//         z - the corresponding eigen vectors in the COLUMNS!!!
-static void eigen(double *d, double *e, int n, double **z)
+// input: d - diagonal of symmetric tridiagonal matrix
+//        e - offdiagonal of symmetric tridiagonal matrix
+//        z - identity if you want eigensystem of symmetric tridiagonal matrix
+//          - OR the householder reduction of a symmetric matrix
+// output: d - eigenvalues
+//         z - the corresponding eigen vectors in the COLUMNS!!!
+static void eigen(double *d, double *e, int n, double **z)
+{
+    double pythag(double a, double b);
+    int m, l, iter, i, k;
+    double s, r, p, g, f, dd, c, b;
+
+      // Convenient to renumber the elements of e.
+    for (i=1; i<n; i++) e[i-1]=e[i];
+    e[n-1]=0.0;
+
+    for (l=0; l<n; l++) {
+        iter=0;
+        do {
+            // Look for a single small subdiagonal element to split the matrix.
+            for (m=l; m<n-1; m++) {
+                dd=fabs(d[m])+fabs(d[m+1]);
+                if ((double)(fabs(e[m])+dd) == dd) break;
+            }
+
+            if (m != l) {
+                if (iter++ == 30) printf("Too many iterations in tqli");
+                g=(d[l+1]-d[l])/(2.0*e[l]);       // Form shift.
+                r=pythag(g, 1.0);
+                g=d[m]-d[l]+e[l]/(g+SIGN(r, g));       // This is dm - ks.
+                s=c=1.0;
+                p=0.0;
+                for (i=m-1; i>=l; i--) {      // A plane rotation as in the original QL, followed by Givens
+                    f=s*e[i];                // rotations to restore tridiagonal form.
+                    b=c*e[i];
+                    e[i+1]=(r=pythag(f, g));
+                    if (r == 0.0) {      // Recover from underflow.
+                        d[i+1] -= p;
+                        e[m]=0.0;
+                        break;
+                    }
+                    s=f/r;
+                    c=g/r;
+                    g=d[i+1]-p;
+                    r=(d[i]-g)*s+2.0*c*b;
+                    d[i+1]=g+(p=s*r);
+                    g=c*r-b;
+                    // Next loop can be omitted if eigenvectors not wanted
+                    // Form eigenvectors.
+                    for (k=0; k<n; k++) {
+                        f=z[k][i+1];
+                        z[k][i+1]=s*z[k][i]+c*f;
+                        z[k][i]=c*z[k][i]-s*f;
+                    }
+                }
+                if (r == 0.0 && i >= l) continue;
+                d[l] -= p;
+                e[l]=g;
+                e[m]=0.0;
+            }
+        } while (m != l);
+    }
+}
+
+
+// ******************************************************************************
+// Computes (a2 + b2)1/2 without destructive underflow or overflow.
+//
+double pythag(double a, double b)
+{
+    double absa, absb;
+    absa=fabs(a);
+    absb=fabs(b);
+    if (absa > absb) return absa*sqrt(1.0+(absb/absa)*(absb/absa));
+    else return (absb == 0.0 ? 0.0 : absb*sqrt(1.0+(absa/absb)*(absa/absb)));
+}
+
+
+// // // // // // // // // // // // // // // // // // // // // // // // // // // // // //
+//
+// translated from gaussj in Numerical Recipes in C, pg 36
+//
+// Linear equation solution by Gauss-Jordan elemination. a[0..n-1][0..n-1]
+// is an input matrix of n by n elements. b[0..n-1][0..m-1] is an input
+// matrix of n by m containing the m right-hand side vectors. On output, a is
+// replaced by its matrix inverse, and b is replaced by the corresponding set
+// of solution vectors.
+//
+// returns true if successful and returns false if matrix is singular
+#define SWAP(a,b) {double temp=(a); (a)=(b); (b)=temp; }
+static bool gaussj(double **a, int n, double **b, int m)
+{
+    int *ipiv;
+    int *indxr, *indxc;
+    int i, j, k, l, ll;
+    int icol=-666, irow=-666;  // init these so uninitialized warning does not occur
+    double big, pivinv;
+
+    // allocate some temp space for pivoting (in C++11 we could allocate in declaration)
+    // Jack A. suggests using a vector anyway.
+    ipiv = new int[n];
+    indxr = new int[n];
+    indxc = new int[n];
+
+    for (j=0; j<n; j++) ipiv[j] = 0;
+
+    // This is the main loop over the columns to be reduced
+    for (i=0; i<n; i++) {
+        big = 0.0;
+
+        // select the largest a[irow][icol]
+        for (j=0; j<n; j++) {
+            if (ipiv[j] != 1)  {
+                for (k=0; k<n; k++) {
+                    if (ipiv[k] == 0) {
+                        if (fabs(a[j][k]) >= big) {
+                            big = fabs(a[j][k]);
+                            irow = j;
+                            icol = k;
+                        }
+                    }
+                    else {
+                        if (ipiv[k] > 1) {
+                            printf("SYSTEM ERROR(gaussj): Singular Matrix type 1\n");
+                            fflush(stdout);
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        ipiv[icol]++;
+
+
+        // We now have the pivot element, so we intechange rows, if needed
+        // to put the pivot element on the diagonal. The columns are not
+        // physically interchanged, only relabeled: indxc[i], the column
+        // of the ith pivot element, is the ith column that is reduced, while
+        // indxr[i] is the row in which that pivot element was originally located.
+        // If indxr[i] != indxc[i] there is an implied column interchange.
+        // With this form of bookkeeping, the solution b's will end up in the
+        // correct order, and the inverse matrix will be scrambled by columns
+        if (irow != icol) {
+            for (l=0; l<n; l++) SWAP(a[irow][l],a[icol][l]);
+            for (l=0; l<m; l++) SWAP(b[irow][l],b[icol][l]);
+        }
+
+        // We are now ready to divide the pivot row by the pivot element
+        // located at irow and icol
+        indxr[i] = irow;
+        indxc[i] = icol;
+// zzz    catastrophic subtraction can happen with
+//        double data[] = {0, 1, 2, 3,
+//                 4, 5, 6, 7,
+//                 8, 9, 10, 11};
+//        printf("A: %lg\n", a[icol][icol]);
+//            fflush(stdout);
+        if (a[icol][icol] == 0.0) {
+            return false;   // matrix is singular!!
+        }
+
+        pivinv = 1.0/a[icol][icol];
+        a[icol][icol] = 1.0;
+        for (l=0; l<n; l++) a[icol][l] *= pivinv;
+        for (l=0; l<m; l++) b[icol][l] *= pivinv;
+
+        // next, we reduce the rows ...
+        // .. except for the pivot one, of course.
+        // DANGER: beware of catastrophic subtraction!!! -RH
+        for (ll=0; ll<n; ll++) {
+            if (ll != icol) {
+                double dum;
+
+                dum = a[ll][icol];
+                a[ll][icol] = 0.0;
+                for (l=0; l<n; l++) {
+                    a[ll][l] -= a[icol][l]*dum;
+                }
+                for (l=0; l<m; l++) {
+                    b[ll][l] -= b[icol][l]*dum;
+                }
+            }
+
+            //RH zzz put *real* test for catastrophic subtraction here.  This is totally bogus!!
+            if (fabs(a[ll][ll]) < 1E-14) a[ll][ll]=0;
+            //RH printf("LLA: %lg\n", a[ll][ll]);  // zzz
+        }
+    }
+
+    // This is the end of the main loop over columns of the reduction.
+    // it only remains to unscramble the solution in view of the column
+    // interchanges. We do this by interchanging pairs of columns in the reverse
+    // order that the permutation was built.
+    for (l=n-1; l>=0; l--) {
+        if (indxr[l] != indxc[l]) {
+            for (k=0; k<n; k++) SWAP(a[k][indxr[l]], a[k][indxc[l]]);
+        }
+    }
+
+    return true;
+}
+
+
+
+
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+// Sorting support
+//
+// The row sorts all use introsort: a quicksort with a median of three
+// (ninther for large ranges) pivot and three way partitioning so runs
+// of equal keys are finished in one pass, insertion sort for small
+// ranges, and a switch to heapsort if the recursion gets too deep.
+// This is O(n log n) in the worst case including already sorted,
+// reversed, and all equal inputs which the old last-element-pivot
+// quicksort handled in O(n^2).  The routines are templates over the
+// type of thing being sorted so they work on arrays of row pointers
+// (moving whole rows cheaply) and on arrays of row indices (argsort).
+// cmp(a, b) returns <0, 0, or >0 like strcmp.  All the sorts, by
+// comparison, radix or normalized keys, order doubles as orderedKey
+// does, so NaNs go to the ends by sign whichever sort is used.
+//
+
+// insertion sort a[lower]...a[upper]
+template <class T, class Cmp>
+static void insertionSortAux(T *a, int lower, int upper, Cmp &cmp)
+{
+    for (int i=lower+1; i<=upper; i++) {
+        T tmp = a[i];
+        int j = i-1;
+
+        while (j>=lower && cmp(tmp, a[j])<0) {
+            a[j+1] = a[j];
+            j--;
+        }
+        a[j+1] = tmp;
+    }
+}
+
+
+// sift down for heapsort of a[lower]...a[lower+size-1]
+template <class T, class Cmp>
+static void siftDownAux(T *a, int lower, int root, int size, Cmp &cmp)
+{
+    T tmp = a[lower+root];
+
+    for (;;) {
+        int child = 2*root+1;
+
+        if (child>=size) break;
+        if (child+1<size && cmp(a[lower+child], a[lower+child+1])<0) child++;
+        if (cmp(tmp, a[lower+child])>=0) break;
+        a[lower+root] = a[lower+child];
+        root = child;
+    }
+    a[lower+root] = tmp;
+}
+
+
+// heapsort a[lower]...a[upper].  Guaranteed O(n log n) fallback.
+template <class T, class Cmp>
+static void heapSortAux(T *a, int lower, int upper, Cmp &cmp)
+{
+    int size = upper-lower+1;
+
+    for (int i=size/2-1; i>=0; i--) siftDownAux(a, lower, i, size, cmp);
+    for (int end=size-1; end>0; end--) {
+        T tmp = a[lower]; a[lower] = a[lower+end]; a[lower+end] = tmp;
+        siftDownAux(a, lower, 0, end, cmp);
+    }
+}
+
+
+// index of the median of a[i], a[j], a[k]
+template <class T, class Cmp>
+static int median3Aux(T *a, int i, int j, int k, Cmp &cmp)
+{
+    if (cmp(a[i], a[j])<0) {
+        if (cmp(a[j], a[k])<0) return j;
+        return (cmp(a[i], a[k])<0) ? k : i;
+    }
+    if (cmp(a[i], a[k])<0) return i;
+    return (cmp(a[j], a[k])<0) ? k : j;
+}
+
+
+// pick a pivot from a[lower]...a[upper] (median of 3 or for large
+// ranges Tukey's ninther) and partition three ways around it:
+// [lower, lt) < pivot, [lt, gt] == pivot, (gt, upper] > pivot.
+// Shared by introSortAux and introSelect.
+template <class T, class Cmp>
+static void partitionAux(T *a, int lower, int upper, int &lt, int &gt, Cmp &cmp)
+{
+    int n, mid, p, i;
+    T pivot;
+
+    n = upper-lower+1;
+    mid = lower + n/2;
+    if (n>128) {
+        int s = n/8;
+        p = median3Aux(a,
+                       median3Aux(a, lower, lower+s, lower+2*s, cmp),
+                       median3Aux(a, mid-s, mid, mid+s, cmp),
+                       median3Aux(a, upper-2*s, upper-s, upper, cmp),
+                       cmp);
+    }
+    else {
+        p = median3Aux(a, lower, mid, upper, cmp);
+    }
+    pivot = a[p];
+
+    lt = lower;
+    gt = upper;
+    i = lower;
+    while (i<=gt) {
+        int c = cmp(a[i], pivot);
+
+        if (c<0) {
+            T tmp = a[lt]; a[lt] = a[i]; a[i] = tmp;
+            lt++;
+            i++;
+        }
+        else if (c>0) {
+            T tmp = a[gt]; a[gt] = a[i]; a[i] = tmp;
+            gt--;
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+
+// introsort a[lower]...a[upper] inclusive.  depth is the number of
+// bad partitions allowed before giving up and using heapsort.
+template <class T, class Cmp>
+static void introSortAux(T *a, int lower, int upper, int depth, Cmp &cmp)
+{
+    while (upper-lower>=32) {
+        int lt, gt;
+
+        if (depth--<=0) {
+            heapSortAux(a, lower, upper, cmp);
+            return;
+        }
+
+        partitionAux(a, lower, upper, lt, gt, cmp);
+
+        // recurse on the smaller side and loop on the larger to bound the stack
+        if (lt-lower < upper-gt) {
+            introSortAux(a, lower, lt-1, depth, cmp);
+            lower = gt+1;
+        }
+        else {
+            introSortAux(a, gt+1, upper, depth, cmp);
+            upper = lt-1;
+        }
+    }
+
+    if (upper>lower) insertionSortAux(a, lower, upper, cmp);
+}
+
+
+// sort a[lower]...a[upper] inclusive
+template <class T, class Cmp>
+static void introSort(T *a, int lower, int upper, Cmp cmp)
+{
+    int depth;
+
+    depth = 0;
+    for (int n=upper-lower+1; n>1; n>>=1) depth += 2;    // 2 log2(n)
+
+    introSortAux(a, lower, upper, depth, cmp);
+}
+
+
+// introselect: partially sort a[lower]...a[upper] so that a[k] is the
+// element that would be there if the range were sorted, everything
+// before it is <= and everything after it is >=.  Partitions with
+// partitionAux like introSortAux but only follows the side containing k so it is expected linear time.  If the partitions
+// go badly too many times it heapsorts what is left.
+template <class T, class Cmp>
+static void introSelect(T *a, int lower, int upper, int k, Cmp cmp)
+{
+    int depth;
+
+    depth = 0;
+    for (int n=upper-lower+1; n>1; n>>=1) depth += 2;    // 2 log2(n)
+
+    while (upper-lower>=32) {
+        int lt, gt;
+
+        if (depth--<=0) {
+            heapSortAux(a, lower, upper, cmp);
+            return;
+        }
+
+        partitionAux(a, lower, upper, lt, gt, cmp);
+
+        if (k<lt) upper = lt-1;
+        else if (k>gt) lower = gt+1;
+        else return;                     // k is in the run equal to the pivot
+    }
+
+    if (upper>lower) insertionSortAux(a, lower, upper, cmp);
+}
+
+
+// map a double to an unsigned 64 bit key with the same ordering so
+// keys can be sorted as integers.  Positive numbers get the sign bit
+// set and negative numbers have all bits flipped.  -0.0 is made 0.0 so
+// it ties with 0.0 as it does when compared as doubles.  A NaN with
+// the sign bit clear sorts after +inf and one with it set before -inf.
+static inline unsigned long long orderedKey(double x)
+{
+    unsigned long long u;
+
+    if (x==0.0) x = 0.0;
+    memcpy(&u, &x, sizeof(u));
+
+    return (u>>63) ? ~u : (u | 0x8000000000000000ULL);
+}
+
+
+// compare two doubles: -1, 0, 1 in the order of orderedKey so the
+// comparison sorts and the radix and key sorts agree even on NaNs.
+// Only ties and NaNs get past the first two tests.
+static inline int compareDoubles(double x, double y)
+{
+    unsigned long long kx, ky;
+
+    if (x<y) return -1;
+    if (x>y) return 1;
+    if (x==y) return 0;
+
+    kx = orderedKey(x);
+    ky = orderedKey(y);
+    return (kx<ky) ? -1 : (kx>ky);
+}
+
+
+// compare two rows on all columns in order (lexicographic)
+struct RowCmp {
+    int maxc;
+    int operator()(const double *x, const double *y) const {
+        for (int c=0; c<maxc; c++) {
+            int d = compareDoubles(x[c], y[c]);
+
+            if (d!=0) return d;
+        }
+        return 0;
+    }
+};
+
+
+// compare two rows on a single column
+struct ColCmp {
+    int c;
+    int operator()(const double *x, const double *y) const {
+        return compareDoubles(x[c], y[c]);
+    }
+};
+
+
+// compare two rows on a single column but in decreasing order
+struct ColCmpDecreasing {
+    int c;
+    int operator()(const double *x, const double *y) const {
+        return compareDoubles(y[c], x[c]);
+    }
+};
+
+
+// compare two doubles
+struct DoubleCmp {
+    int operator()(double x, double y) const {
+        return compareDoubles(x, y);
+    }
+};
+
+
+// compare two row indices by a single column breaking ties by index
+// which makes the resulting permutation stable
+struct IndexColCmp {
+    double **m;
+    int c;
+    int operator()(int i, int j) const {
+        int d = compareDoubles(m[i][c], m[j][c]);
+
+        if (d!=0) return d;
+        return (i<j) ? -1 : (i>j);
+    }
+};
+
+
+// parallel merge sort of a[lower]...a[upper] inclusive.  The range is
+// cut into one chunk per thread and each chunk is sorted in its own
+// thread by sortChunk(a+lower, first, last), which must give the order
+// cmp does.  Then neighboring sorted chunks are merged pairwise, again one
+// thread per merge, ping-ponging between a and a scratch array until
+// one sorted run is left.
+template <class T, class Cmp, class Sort>
+static void parallelSort(T *a, int lower, int upper, Cmp cmp, int threads, Sort sortChunk)
+{
+    int n = upper-lower+1;
+    std::vector<int> bound(threads+1);
+    std::vector<std::thread> pool;
+
+    for (int i=0; i<=threads; i++) bound[i] = int((long long)n*i/threads);
+
+    // sort the chunks
+    for (int i=0; i<threads; i++) {
+        pool.push_back(std::thread([a, lower, &bound, sortChunk, i]() {
+            if (bound[i+1]-bound[i]>1) sortChunk(a+lower, bound[i], bound[i+1]-1);
+        }));
+    }
+    for (unsigned int i=0; i<pool.size(); i++) pool[i].join();
+    pool.clear();
+
+    // merge neighboring runs until there is one
+    std::vector<T> scratch(n);
+    T *src = a+lower;
+    T *dst = scratch.data();
+    for (int width=1; width<threads; width*=2) {
+        for (int i=0; i<threads; i+=2*width) {
+            int lo = bound[i];
+            int mid = bound[std::min(i+width, threads)];
+            int hi = bound[std::min(i+2*width, threads)];
+
+            pool.push_back(std::thread([src, dst, lo, mid, hi, cmp]() {
+                std::merge(src+lo, src+mid, src+mid, src+hi, dst+lo,
+                           [&cmp](const T &x, const T &y) { return cmp(x, y)<0; });
+            }));
+        }
+        for (unsigned int i=0; i<pool.size(); i++) pool[i].join();
+        pool.clear();
+
+        T *tmp = src; src = dst; dst = tmp;
+    }
+
+    if (src!=a+lower) {
+        for (int i=0; i<n; i++) a[lower+i] = src[i];
+    }
+}
+
+
+// parallel merge sort with each chunk introsorted
+template <class T, class Cmp>
+static void parallelSort(T *a, int lower, int upper, Cmp cmp, int threads)
+{
+    parallelSort(a, lower, upper, cmp, threads, [cmp](T *x, int first, int last) {
+        introSort(x, first, last, cmp);
+    });
+}
+
+
+// how many threads to use to sort n rows (1 means sort serially)
+static int sortThreadCount(int n)
+{
+    int threads;
+
+    if (n<Matrix::parallelSortMin) return 1;
+
+    threads = Matrix::sortThreads;
+    if (threads<=0) threads = std::thread::hardware_concurrency();
+    if (threads>n/1024) threads = n/1024;    // keep chunks from getting silly small
+    if (threads<1) threads = 1;
+
+    return threads;
+}
+
+
+// LSD radix sort of the row numbers lower...upper inclusive on column c.
+// The (key, row) pairs are sorted 11 bits at a time, low digit first,
+// with a counting sort which is stable so ties keep their original
+// order.  Passes in which every key has the same digit are skipped.
+// The sorted row numbers are left in row.
+static void radixSortIndex(double **m, int c, int lower, int upper, std::vector<int> &row)
+{
+    const int bits = 11;
+    const int radix = 1<<bits;
+    const int passes = (64+bits-1)/bits;
+    int n = upper-lower+1;
+
+    std::vector<unsigned long long> key(n), keyTmp(n);
+    std::vector<int> rowTmp(n);
+    std::vector<int> count(passes*radix, 0);
+
+    row.resize(n);
+
+    // make keys and count the digits for every pass in one sweep
+    for (int i=0; i<n; i++) {
+        unsigned long long k = orderedKey(m[lower+i][c]);
+
+        key[i] = k;
+        row[i] = lower+i;
+        for (int p=0; p<passes; p++) count[p*radix + ((k>>(p*bits)) & (radix-1))]++;
+    }
+
+    for (int p=0; p<passes; p++) {
+        int *cnt = &count[p*radix];
+        int sum;
+
+        // skip a pass where everyone has the same digit
+        if (cnt[(key[0]>>(p*bits)) & (radix-1)]==n) continue;
+
+        // counts -> starting positions
+        sum = 0;
+        for (int d=0; d<radix; d++) {
+            int tmp = cnt[d];
+            cnt[d] = sum;
+            sum += tmp;
+        }
+
+        for (int i=0; i<n; i++) {
+            int pos = cnt[(key[i]>>(p*bits)) & (radix-1)]++;
+
+            keyTmp[pos] = key[i];
+            rowTmp[pos] = row[i];
+        }
+        key.swap(keyTmp);
+        row.swap(rowTmp);
+    }
+}
+
+
+// LSD radix sort of rows lower...upper inclusive on column c.  The row
+// pointers are moved once into their sorted order.
+static void radixSortRows(double **m, int c, int lower, int upper)
+{
+    int n = upper-lower+1;
+    std::vector<int> row;
+
+    radixSortIndex(m, c, lower, upper, row);
+
+    // move the row pointers into place all at once
+    std::vector<double *> sorted(n);
+    for (int i=0; i<n; i++) sorted[i] = m[row[i]];
+    for (int i=0; i<n; i++) m[lower+i] = sorted[i];
+}
+
+
+// build normalized keys for rows lower...lower+n-1.  Each row gets one
+// 64 bit word per key column holding the orderedKey (complemented for
+// descending columns), so comparing two keys word by word gives the
+// lexicographic order of the rows on those columns.  Comparing keys is
+// then integer compares on a contiguous array instead of chasing row
+// pointers and comparing doubles.
+static void makeRowKeys(double **m, int lower, int n, int numCols, const int *cols,
+                        const bool *descending, std::vector<unsigned long long> &keys)
+{
+    keys.resize((size_t)n*numCols);
+    for (int i=0; i<n; i++) {
+        unsigned long long *p = &keys[(size_t)i*numCols];
+
+        for (int j=0; j<numCols; j++) {
+            unsigned long long k = orderedKey(m[lower+i][cols[j]]);
+
+            p[j] = (descending && descending[j]) ? ~k : k;
+        }
+    }
+}
+
+
+// compare two normalized keys of len words: -1, 0, 1
+static inline int keyCompare(const unsigned long long *x, const unsigned long long *y, int len)
+{
+    for (int i=0; i<len; i++) {
+        if (x[i]!=y[i]) return (x[i]<y[i]) ? -1 : 1;
+    }
+    return 0;
+}
+
+
+// a row number with one word of its normalized key, so comparisons
+// never leave the array being sorted
+struct KeyRef {
+    unsigned long long word;
+    int row;
+};
+
+
+// compare two KeyRefs by the key word only
+struct KeyWordCmp {
+    int operator()(const KeyRef &x, const KeyRef &y) const {
+        return (x.word<y.word) ? -1 : (x.word>y.word);
+    }
+};
+
+
+// compare two KeyRefs by the key word breaking ties by row number
+struct KeyRefCmp {
+    int operator()(const KeyRef &x, const KeyRef &y) const {
+        if (x.word!=y.word) return (x.word<y.word) ? -1 : 1;
+        return (x.row<y.row) ? -1 : (x.row>y.row);
+    }
+};
+
+
+// multikey sort of ref[lower...upper] on normalized keys of len words
+// starting at word w: sort on word w, then each run that ties on word w
+// is sorted on word w+1 and so on.  Only the last word breaks ties by
+// row number, so rows that tie on the whole key end up in row number
+// order and the sort is stable.
+static void sortKeysAux(const unsigned long long *keys, int len, KeyRef *ref, int lower, int upper, int w)
+{
+    for (int i=lower; i<=upper; i++) ref[i].word = keys[(size_t)ref[i].row*len + w];
+
+    if (w+1>=len) {
+        introSort(ref, lower, upper, KeyRefCmp());
+        return;
+    }
+    introSort(ref, lower, upper, KeyWordCmp());
+
+    for (int i=lower; i<=upper; ) {
+        int j = i+1;
+
+        while (j<=upper && ref[j].word==ref[i].word) j++;
+        if (j-i>1) sortKeysAux(keys, len, ref, i, j-1, w+1);
+        i = j;
+    }
+}
+
+
+// sort normalized keys of len words for n rows returning the row
+// numbers (0...n-1) in sorted order in ref
+static void sortKeys(const std::vector<unsigned long long> &keys, int n, int len, std::vector<KeyRef> &ref)
+{
+    ref.resize(n);
+    for (int i=0; i<n; i++) ref[i].row = i;
+    if (n>1) sortKeysAux(keys.data(), len, ref.data(), 0, n-1, 0);
+}
+
+
+// sort rows lower...upper inclusive lexicographically on the given
+// columns by sorting normalized keys, then moving the row pointers into
+// place once.  Stable.
+static void keySortRows(double **m, int lower, int upper, int numCols, const int *cols,
+                        const bool *descending)
+{
+    int n = upper-lower+1;
+    std::vector<unsigned long long> keys;
+    std::vector<KeyRef> ref;
+
+    makeRowKeys(m, lower, n, numCols, cols, descending, keys);
+    sortKeys(keys, n, numCols, ref);
+
+    std::vector<double *> sorted(n);
+    for (int i=0; i<n; i++) sorted[i] = m[lower+ref[i].row];
+    for (int i=0; i<n; i++) m[lower+i] = sorted[i];
+}
+
+
+// introsort the rows lower...upper inclusive using all columns.
+// Large ranges are sorted in parallel (see sortThreads).  Otherwise
+// ranges of narrow rows are sorted on normalized keys so comparisons
+// are integer compares in a contiguous array.  Wide rows compare
+// directly rather than make keys as big as the matrix, and short
+// ranges are not worth making keys for.
+void Matrix::qs(int lower, int upper)
+{
+    RowCmp cmp;
+    int threads;
+
+    cmp.maxc = maxc;
+    threads = sortThreadCount(upper-lower+1);
+    if (threads>1) parallelSort(m, lower, upper, cmp, threads);
+    else if (maxc<=16 && upper-lower+1>=64) {
+        int cols[16];
+
+        for (int c=0; c<maxc; c++) cols[c] = c;
+        keySortRows(m, lower, upper, maxc, cols, NULL);
+    }
+    else introSort(m, lower, upper, cmp);
+}
+
+
+// sort the rows lower...upper inclusive by a single column.  Ranges big
+// enough (see sortThreads) are cut into one piece per thread which are
+// sorted at the same time and then merged.  The whole range, or each
+// piece, is radix sorted if it has at least radixSortMin rows and
+// introsorted otherwise.
+void Matrix::qsCol(int c, int lower, int upper)
+{
+    ColCmp cmp;
+    int threads;
+
+    cmp.c = c;
+    threads = sortThreadCount(upper-lower+1);
+    if (threads>1) {
+        parallelSort(m, lower, upper, cmp, threads, [c, cmp](double **a, int first, int last) {
+            if (radixSortMin>0 && last-first+1>=radixSortMin) radixSortRows(a, c, first, last);
+            else introSort(a, first, last, cmp);
+        });
+    }
+    else if (radixSortMin>0 && upper-lower+1>=radixSortMin) radixSortRows(m, c, lower, upper);
+    else introSort(m, lower, upper, cmp);
+}
+
+
+// partition the rows lower...upper inclusive on column c so that row k
+// holds the row that would be there if the range were sorted by column
+// c, the rows lower...k-1 have values <= it and the rows k+1...upper
+// have values >= it.  This is expected linear time rather than the
+// O(n log n) of a full sort so use it to find medians, percentiles or
+// the split row when building trees.  k is a row number in lower...upper.
+// WARNING: reorders rows in place
+Matrix &Matrix::selectRowsByCol(int k, int c, int lower, int upper)
+{
+    ColCmp cmp;
+
+    assertDefined("selectRowsByCol");
+    assertColIndexOK(c, "selectRowsByCol");
+    assertRowIndexOK(lower, "selectRowsByCol");
+    assertRowIndexOK(upper, "selectRowsByCol");
+    assertArgNondecreasing(lower, 3, upper, 4, "selectRowsByCol");
+    if (k<lower || k>upper) {
+        printf("ERROR(selectRowsByCol): row to select %d must be in the range of rows %d to %d\n", k, lower, upper);
+        exit(1);
+    }
+
+    cmp.c = c;
+    introSelect(m, lower, upper, k, cmp);
+
+    return *this;
+}
+
+
+// same as above but over all the rows
+Matrix &Matrix::selectRowsByCol(int k, int c)
+{
+    assertDefined("selectRowsByCol");
+
+    return selectRowsByCol(k, c, 0, maxr-1);
+}
+
+
+// the median of column c.  For an even number of rows it is the mean of
+// the two middle values.  Uses selection on a copy of the column so self
+// is not changed.
+double Matrix::medianCol(int c) const
+{
+    return percentileCol(c, 0.5);
+}
+
+
+// the value at fraction p (0 <= p <= 1) of the way through column c if it
+// were sorted, interpolating linearly between neighboring values.
+// Uses selection on a copy of the column so self is not changed.
+double Matrix::percentileCol(int c, double p) const
+{
+    double pos, frac, lo, hi;
+    int k;
+    DoubleCmp cmp;
+
+    assertDefined("percentileCol");
+    assertColIndexOK(c, "percentileCol");
+    if (maxr<1 || !(p>=0.0 && p<=1.0)) {    // written so NaN fails
+        printf("ERROR(percentileCol): need at least one row and 0 <= p <= 1 but have %d rows and p=%lg\n", maxr, p);
+        exit(1);
+    }
+
+    std::vector<double> col(maxr);
+    for (int r=0; r<maxr; r++) col[r] = m[r][c];
+
+    pos = p*(maxr-1);
+    k = int(pos);
+    frac = pos-k;
+
+    introSelect(col.data(), 0, maxr-1, k, cmp);
+    lo = col[k];
+    if (frac==0.0) return lo;
+
+    // the next value up is the smallest of those above k
+    hi = col[k+1];
+    for (int r=k+2; r<maxr; r++) if (col[r]<hi) hi = col[r];
+
+    return lo + frac*(hi-lo);
+}
+
+
+// heap selection: move the k smallest (according to cmp) of a[0]...a[n-1]
+// into a[0]...a[k-1] in increasing order.  a[0]...a[k-1] is kept as a
+// heap with the largest of the k at the top so each later element only
+// costs a compare unless it beats the top.
+template <class T, class Cmp>
+static void heapSelect(T *a, int n, int k, Cmp cmp)
+{
+    for (int i=k/2-1; i>=0; i--) siftDownAux(a, 0, i, k, cmp);
+    for (int u=k; u<n; u++) {
+        if (cmp(a[u], a[0])<0) {
+            T tmp = a[0]; a[0] = a[u]; a[u] = tmp;
+            siftDownAux(a, 0, 0, k, cmp);
+        }
+    }
+    for (int end=k-1; end>0; end--) {
+        T tmp = a[0]; a[0] = a[end]; a[end] = tmp;
+        siftDownAux(a, 0, 0, end, cmp);
+    }
+}
+
+
+// the permutation that would sort the rows by column c.  Returns a
+// column vector of row numbers: row argsort[0] has the smallest value
+// in column c and so on.  Ties keep their original order (stable).
+// Self is not changed.
+// WARNING: allocates new matrix for answer
+Matrix Matrix::argsortByCol(int c) const
+{
+    IndexColCmp cmp;
+
+    assertDefined("argsortByCol");
+    assertColIndexOK(c, "argsortByCol");
+
+    std::vector<int> index(maxr);
+    if (radixSortMin>0 && maxr>=radixSortMin) radixSortIndex(m, c, 0, maxr-1, index);
+    else {
+        for (int r=0; r<maxr; r++) index[r] = r;
+
+        cmp.m = m;
+        cmp.c = c;
+        if (maxr>1) introSort(index.data(), 0, maxr-1, cmp);
+    }
+
+    Matrix out(maxr, 1, "argsort" + name);
+    for (int r=0; r<maxr; r++) out.m[r][0] = index[r];
+    out.defined = true;
+
+    return out;
+}
+
+
+// the permutation that would sort the rows using all columns as
+// sortRows does.  Ties keep their original order (stable).
+// WARNING: allocates new matrix for answer
+Matrix Matrix::argsortRows() const
+{
+    assertDefined("argsortRows");
+
+    std::vector<int> cols(maxc);
+    for (int c=0; c<maxc; c++) cols[c] = c;
+
+    return argsortByCols(maxc, cols.data());
+}
+
+
+// the permutation that would sort the rows on a list of columns as
+// sortRowsByCols does.  Ties keep their original order (stable).
+// WARNING: allocates new matrix for answer
+Matrix Matrix::argsortByCols(int numCols, const int *cols, const bool *descending) const
+{
+    std::vector<unsigned long long> keys;
+    std::vector<KeyRef> ref;
+
+    assertDefined("argsortByCols");
+    if (numCols<1) {
+        printf("ERROR(argsortByCols): number of key columns must be positive: %d\n", numCols);
+        exit(1);
+    }
+    for (int i=0; i<numCols; i++) assertColIndexOK(cols[i], "argsortByCols");
+
+    makeRowKeys(m, 0, maxr, numCols, cols, descending, keys);
+    sortKeys(keys, maxr, numCols, ref);
+
+    Matrix out(maxr, 1, "argsort" + name);
+    for (int r=0; r<maxr; r++) out.m[r][0] = ref[r].row;
+    out.defined = true;
+
+    return out;
+}
+
+
+// reorder the rows so that new row i is old row perm[i] where perm is
+// a column vector permutation such as made by the argsort routines.
+// Only row pointers move so it costs the same however wide the rows.
+// WARNING: reorders in place
+Matrix &Matrix::applyPermutation(const Matrix &perm)
+{
+    std::vector<Matrix *> mats(1, this);
+
+    applyPermutation(perm, mats);
+
+    return *this;
+}
+
+
+// reorder the rows of every matrix in mats by the same permutation in
+// one pass over perm.  All the matrices must have as many rows as perm.
+// For example sort distances and reorder the labels to match with
+//     Matrix perm = dist.argsortByCol(0);
+//     Matrix::applyPermutation(perm, {&dist, &labels});
+// WARNING: reorders in place
+void Matrix::applyPermutation(const Matrix &perm, const std::vector<Matrix *> &mats)
+{
+    int n = perm.maxr;
+
+    for (Matrix *mat : mats) {
+        mat->assertDefined("applyPermutation");
+        perm.assertRowsEqual(*mat, "applyPermutation");
+    }
+    perm.assertPermutation(n, "applyPermutation");
+
+    // gather the new row order for all matrices together
+    std::vector<double *> rows((size_t)n*mats.size());
+    for (int i=0; i<n; i++) {
+        int from = int(perm.m[i][0]);
+
+        for (size_t j=0; j<mats.size(); j++) rows[j*n+i] = mats[j]->m[from];
+    }
+
+    for (size_t j=0; j<mats.size(); j++) {
+        for (int i=0; i<n; i++) mats[j]->m[i] = rows[j*n+i];
+    }
+}
+
+
+// sort the rows of a matrix.   WARNING: SORTS IN PLACE
+Matrix &Matrix::sortRows() {
+    assertDefined("sortRows");
+    if (maxr>1) qs(0, maxr-1);
+
+    return *this;
+}
+
+
+
+// put the k smallest rows by column c into the first k rows in
+// increasing order.  Uses a heap of the best k rows seen so far so it
+// is O(n log k) rather than the O(n k) of repeated selection.  The
+// remaining rows are left in no particular order.
+// WARNING: reorders rows in place
+Matrix &Matrix::minKRowsByColSelf(int k, int c)
+{
+    ColCmp cmp;
+
+    assertDefined("minKRowsByColSelf");
+    assertRowIndexOK(k-1, "minKRowsByColSelf");
+    assertColIndexOK(c, "minKRowsByColSelf");
+
+    cmp.c = c;
+    heapSelect(m, maxr, k, cmp);
+
+    return *this;
+}
+
+
+// put the k largest rows by column c into the first k rows in
+// decreasing order.  O(n log k) (see minKRowsByColSelf)
+// WARNING: reorders rows in place
+Matrix &Matrix::maxKRowsByColSelf(int k, int c)
+{
+    ColCmpDecreasing cmp;
+
+    assertDefined("maxKRowsByColSelf");
+    assertRowIndexOK(k-1, "maxKRowsByColSelf");
+    assertColIndexOK(c, "maxKRowsByColSelf");
+
+    cmp.c = c;
+    heapSelect(m, maxr, k, cmp);
+
+    return *this;
+}
+
+
+// the same result as minKRowsByColSelf but done by selecting the k'th
+// row (expected linear time) and then sorting the k rows before it,
+// so O(n + k log k).  Faster than the heap when k is a large fraction
+// of the rows.
+// WARNING: reorders rows in place
+Matrix &Matrix::partialSortRowsByCol(int k, int c)
+{
+    ColCmp cmp;
+
+    assertDefined("partialSortRowsByCol");
+    assertRowIndexOK(k-1, "partialSortRowsByCol");
+    assertColIndexOK(c, "partialSortRowsByCol");
+
+    cmp.c = c;
+    introSelect(m, 0, maxr-1, k-1, cmp);
+    if (k>1) introSort(m, 0, k-2, cmp);    // row k-1 is already in place
+
+    return *this;
+}
+
+
+Matrix &Matrix::sortRows(int startRow, int endRow) {
+    assertDefined("sortRows");
+    assertRowIndexOK(startRow, "sortRows");
+    assertRowIndexOK(endRow, "sortRows");
+    assertArgNondecreasing(startRow, 1, endRow, 2, "sortRows");
+    if (maxr>1) qs(startRow, endRow);
+
+    return *this;
+}
+
+
+// sort the rows of a matrix using column c as the key.
+// Column numbering starts at 0.
+// WARNING: sorts in place
+Matrix &Matrix::sortRowsByCol(int c) {
+    assertDefined("sortRowsCol");
+    assertColIndexOK(c, "sortRowsByCol");
+    if (maxr>1) qsCol(c, 0, maxr-1);
+
+    return *this;
+}
+
+
+// sort rows in place in a range of rows
+// Column numbering starts at 0.
+// WARNING: sorts in place
+Matrix &Matrix::sortRowsByCol(int c, int startRow, int endRow)
+{
+    assertDefined("sortRowsByCol");
+    assertColIndexOK(c, "sortRowsByCol");
+    assertRowIndexOK(startRow, "sortRowsByCol");
+    assertRowIndexOK(endRow, "sortRowsByCol");
+    assertArgNondecreasing(startRow, 1, endRow, 2, "sortRowsByCol");
+    if (maxr>1) qsCol(c, startRow, endRow);
+
+    return *this;
+}
+
+
+// sort the rows of a matrix using column c as the key with a stable
+// LSD radix sort.  O(n) and rows with equal keys keep their order.
+// WARNING: sorts in place
+Matrix &Matrix::radixSortRowsByCol(int c)
+{
+    assertDefined("radixSortRowsByCol");
+    assertColIndexOK(c, "radixSortRowsByCol");
+    if (maxr>1) radixSortRows(m, c, 0, maxr-1);
+
+    return *this;
+}
+
+
+// stable radix sort of a range of rows using column c as the key
+// WARNING: sorts in place
+Matrix &Matrix::radixSortRowsByCol(int c, int startRow, int endRow)
+{
+    assertDefined("radixSortRowsByCol");
+    assertColIndexOK(c, "radixSortRowsByCol");
+    assertRowIndexOK(startRow, "radixSortRowsByCol");
+    assertRowIndexOK(endRow, "radixSortRowsByCol");
+    assertArgNondecreasing(startRow, 1, endRow, 2, "radixSortRowsByCol");
+    if (endRow>startRow) radixSortRows(m, c, startRow, endRow);
+
+    return *this;
+}
+
+// sort the rows lexicographically on a list of columns: first by
+// cols[0], ties by cols[1] and so on.  If descending is given then
+// descending[i] true sorts column cols[i] largest first.  Rows are
+// compared on precomputed normalized keys.  Stable.
+// WARNING: sorts in place
+Matrix &Matrix::sortRowsByCols(int numCols, const int *cols, const bool *descending)
+{
+    assertDefined("sortRowsByCols");
+    if (numCols<1) {
+        printf("ERROR(sortRowsByCols): number of key columns must be positive: %d\n", numCols);
+        exit(1);
+    }
+    for (int i=0; i<numCols; i++) assertColIndexOK(cols[i], "sortRowsByCols");
+
+    if (maxr>1) keySortRows(m, 0, maxr-1, numCols, cols, descending);
+
+    return *this;
+}
+
+
+// copy of the rows in sorted order with duplicate rows removed.
+// Rows are equal if all their values are equal (0.0 equals -0.0).
+// WARNING: allocates new matrix for answer
+Matrix Matrix::uniqueRows() const
+{
+    assertDefined("uniqueRows");
+
+    std::vector<int> cols(maxc);
+    for (int c=0; c<maxc; c++) cols[c] = c;
+
+    return uniqueRowsByCols(maxc, cols.data());
+}
+
+
+// copy of the rows sorted on the given columns keeping only the first
+// row (lowest row number) for each distinct combination of values in
+// those columns.
+// WARNING: allocates new matrix for answer
+Matrix Matrix::uniqueRowsByCols(int numCols, const int *cols) const
+{
+    std::vector<unsigned long long> keys;
+    std::vector<KeyRef> ref;
+    int count;
+
+    assertDefined("uniqueRowsByCols");
+    if (numCols<1) {
+        printf("ERROR(uniqueRowsByCols): number of key columns must be positive: %d\n", numCols);
+        exit(1);
+    }
+    for (int i=0; i<numCols; i++) assertColIndexOK(cols[i], "uniqueRowsByCols");
+
+    makeRowKeys(m, 0, maxr, numCols, cols, NULL, keys);
+    sortKeys(keys, maxr, numCols, ref);
+
+    // squeeze out rows whose key matches the one before
+    count = 0;
+    for (int r=0; r<maxr; r++) {
+        if (count==0 || keyCompare(&keys[(size_t)ref[r].row*numCols], &keys[(size_t)ref[count-1].row*numCols], numCols)!=0) {
+            ref[count++] = ref[r];
+        }
+    }
+
+    Matrix out(count, maxc, "unique" + name);
+    for (int r=0; r<count; r++) {
+        for (int c=0; c<maxc; c++) out.m[r][c] = m[ref[r].row][c];
+    }
+    out.defined = true;
+
+    return out;
+}
+
+
+// reverse the list of rows
+Matrix &Matrix::reverseRows()
+{
+    int startRow = 0, endRow = maxr-1;
+    assertDefined("reverseRows");
+    
+    while (startRow < endRow) swapRows(startRow++, endRow--);
+
+    return *this;
+}
+
+
+// reverse the list of rows of a given range of rows
+Matrix &Matrix::reverseRows(int startRow, int endRow)
+{
+    assertDefined("reverseRows");
+    assertRowIndexOK(startRow, "reverseRows");
+    assertRowIndexOK(endRow, "reverseRows");
+    assertArgNondecreasing(startRow, 1, endRow, 2, "reverseRows");
+    
+    while (startRow < endRow) swapRows(startRow++, endRow--);
+
+    return *this;
+}
+
+
+// Create a SUBMATRIX. DANGER: This bit of evil is a matrix that
+// POINTS INTO ANOTHER MATRIX! DANGER: Do not use the subMatrix after
+// you deallocate the other matrix!! In a sense this is not a real
+// matrix. If you want this matrix to persist then you have to make a
+// copy of it. It is great for efficiency. IMPORTANT: BE SURE to
+// deallocate this matrix before you deallocate the "mother matrix"
+Matrix Matrix::subMatrix(int minr, int minc, int sizer, int sizec) const
+{
+    if (sizer==0) sizer = maxr - minr;
+    if (sizec==0) sizec = maxc - minc;
+
+    assertIndexOK(minr, minc, "lower bounds submatrix extract");
+    assertIndexOK(minr+sizer-1, minc+sizec-1, "upper bounds submatrix extract");
+
+    Matrix out(sizer);                  // allocate a subMatrix!
+    out.maxc = sizec;                   // fix internal column width
+
+    for (int r=0; r<sizer; r++) {
+        out.m[r] = &(m[minr][minc]);    // DANGER: we are copying pointers into other Matrix!!!
+        minr++;
+    }
+
+    out.defined = true;
+
+    return out;
+}
+
+
+
+// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
+// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
+// deallocate the other matrix!!   In a sense this is not a real matrix.
+// If you want this matrix to persist then you have to make a full copy of it.
+// This will create a submatrix whose rows have value in column c.
+Matrix Matrix::subMatrixEq(int c, double value) const
+{
+    assertColIndexOK(c, "subMatrixEq");
+
+    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
+
+    for (int r=0; r<maxr; r++) {
+        if (m[r][c]==value) rowList.push_back(m[r]);
+    }
+
+    Matrix out(rowList.size(), "sub" + name);                         // allocate a subMatrix!
+    out.maxc = maxc;                                                  // set size
+
+    for (unsigned int r=0; r<rowList.size(); r++) {
+        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
+    }
+
+    out.defined = true;
+
+    return out;
+}
+
+
+// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
+// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
+// deallocate the other matrix!!   In a sense this is not a real matrix.
+// If you want this matrix to persist then you have to make a full copy of it.
+// This will create a submatrix whose rows do not have value in column c.
+Matrix Matrix::subMatrixNeq(int c, double value) const
+{
+    assertColIndexOK(c, "subMatrixNeq");
+
+    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
+
+    for (int r=0; r<maxr; r++) {
+        if (m[r][c]!=value) rowList.push_back(m[r]);
+    }
+
+    Matrix out(rowList.size(), "sub" + name);                         // allocate a subMatrix!
+    out.maxc = maxc;
+
+    for (unsigned int r=0; r<rowList.size(); r++) {
+        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
+    }
+
+    out.defined = true;
+
+    return out;
+}
+
+
+// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
+// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
+// deallocate the other matrix!!   In a sense this is not a real matrix.
+// If you want this matrix to persist then you have to make a full copy of it.
+Matrix Matrix::subMatrixPickRows(const Matrix &list, int match, int matchCol)
+{
+    assertDefined("lhs of subMatrixPickRows");
+    list.assertDefined("rhs of subMatrixPickRows");
+    list.assertColVector("rhs of subMatrixPickRows");
+    assertRowsEqual(list, "subMatrixPickRows");
+    list.assertColIndexOK(matchCol, "rhs of subMatrixPickRows");
+
+    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
+    for (int r=0; r<maxr; r++) {
+        if (list.m[r][matchCol]==match) rowList.push_back(m[r]);
+    }
+
+    if (rowList.size()==0) {
+        Matrix out("subMatrixPickRows Found No Rows In "+name);
+
+        return out;
+    }
+
+    Matrix out(rowList.size());                         // allocate a subMatrix!
+    out.maxc = maxc;
+
+    for (unsigned int r=0; r<rowList.size(); r++) {
+        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
+    }
+
+    out.defined = true;
+
+    return out;
+}
+
+
+
+
+// // // // // // // // // // // // // // // // // // // //
+//
+// image (picture) support (currently just pgm files)
+//
+// image (picture) support (currently only supports 8 bit pgm and ppm formats)
+// output is in ascii formats (zzz: fix someday to use more compressed output)
+// 8 bit gray is one integer in the range 0-255 for each pixel
+// 8 bit color is three integers in a row in the range 0-255 for RGB in each pixel.
+// That is an 8 bit color square 100x100 pixels gens a 100x300 dimensional array
+
+// helper routine for writing images
+int Matrix::byteValue(double x)
+{
+    int z;
+
+    z = int(x);
+    if (z<0) z = 0;
+    if (z>255) z = 255;
+
+    return z;
+}
+
+// helper routine for reading images: opens the file (or uses stdin if
+// filename is empty) and reads the magic number, comments, size and
+// maximum pixel value.  Only magic numbers listed in expectedType are
+// accepted.  Returns the open file positioned just after the maximum value.
+static FILE *readPixmapHeader(std::string expectedType,
+                              std::string caller,
+                              std::string filename,
+                              char *magic,
+                              int &newr,
+                              int &newc,
+                              int &max)
+{
+    const int bufferSize=4096;   // buffer
+    char buffer[bufferSize];
+    char *end;                   // end of the width in buffer
+    bool ok;                     // has the header been read so far
+    FILE *IN;                    // input file
+
+    if (filename.length()>0) {
+        IN = fopen(filename.c_str(), "r");
+        if (IN==NULL) {
+            printf("ERROR(%s): Trying to open file \"%s\" but failed.\n", caller.c_str(), filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        IN = stdin;
+    }
+
+    // get magic number of file
+    if (fscanf(IN, "%2s", magic)!=1) {
+        if (filename.length()>0) {
+            printf("ERROR(%s): Unable to read file magic number for file named \"%s\".\n", caller.c_str(), filename.c_str());
+        }
+        else {
+            printf("ERROR(%s): Unable to read file magic number for file from stdin.\n", caller.c_str());
+        }
+
+        exit(1);
+    }
+
+    if (! (magic[0]=='P' && strisin(magic[1], expectedType.c_str()))) {
+        if (filename.length()>0) {
+            printf("ERROR(%s): Wrong magic number for file named \"%s\".  Expecting P%c or P%c format but had magic number: \"%c%c\".\n",
+                   caller.c_str(),
+                   filename.c_str(),
+                   expectedType[0],
+                   expectedType[1],
+                   magic[0],
+                   magic[1]);
+        }
+        else {
+            printf("ERROR(%s): Wrong magic number for file on stdin.  Expecting P%c or P%c format but had magic number: \"%c%c\".\n",
+                   caller.c_str(),
+                   expectedType[0],
+                   expectedType[1],
+                   magic[0],
+                   magic[1]);
+        }
+
+        exit(1);
+    }
+
+    // read comment lines (Warning: assumes comments come right after magic number)
+    ok = fscanf(IN, "%4095s", buffer)==1;
+    while (ok && *buffer=='#') {
+            fgets(buffer, bufferSize, IN);
+//            printf("# %s", buffer);
+            ok = fscanf(IN, "%4095s", buffer)==1;
+    }
+
+    // read picture parameters
+    if (ok) {
+        newc = strtol(buffer, &end, 10);           // number of cols
+        ok = (*end=='\0' && end!=buffer);
+    }
+    ok = ok && fscanf(IN, "%d", &newr)==1;        // number of rows
+    ok = ok && fscanf(IN, "%d", &max)==1;         // maximum value for pixel
+    if (!ok || newc<0 || newr<0 || max<1) {
+        if (filename.length()>0) {
+            printf("ERROR(%s): Unable to read a valid width, height and maximum value from the header of file named \"%s\".\n",
+                   caller.c_str(), filename.c_str());
+        }
+        else {
+            printf("ERROR(%s): Unable to read a valid width, height and maximum value from the header of file from stdin.\n",
+                   caller.c_str());
+        }
+
+        exit(1);
+    }
+
+    return IN;
+}
+
+
+// helper routine for writing images: opens the file (or uses stdout
+// if filename is empty) and writes the pixmap header.  Returns the open
+// file ready for the pixel values.
+static FILE *writePixmapHeader(const char *caller, const char *magic, const char *kind,
+                               std::string filename, std::string name, std::string comment,
+                               int width, int height, int maxval)
+{
+    FILE *OUT;
+
+    if (filename.length()>0) {
+        OUT = fopen(filename.c_str(), "wb");
+        if (OUT==NULL) {
+            printf("ERROR(%s): Trying to open file \"%s\" but failed.\n", caller, filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        OUT = stdout;
+    }
+
+    fprintf(OUT, "%s\n", magic);
+    if (name.length()>0) fprintf(OUT, "# Name: %s\n", name.c_str());
+    if (comment.length()>0) fprintf(OUT, "# %s\n", comment.c_str());
+    fprintf(OUT, "# %s\n", kind);
+    fprintf(OUT, "%d %d\n", width, height);     // NOTE: columns then rows!
+    fprintf(OUT, "%d\n", maxval);
+
+    return OUT;
+}
+
+
+// helper routine for reading images
+Matrix &Matrix::readImage(std::string expectedType,
+                         std::string caller,
+                         std::string filename,
+                         std::string namex,
+                         bool &isColor)
+{
+    char magic[3];               // magic number
+    FILE *IN;                    // input file
+    int newr, newc, max;               // picture parms
+
+    IN = readPixmapHeader(expectedType, caller, filename, magic, newr, newc, max);
+
+    // is color?
+    isColor = (magic[1]=='3') || (magic[1]=='6');
+    if (isColor) newc *= 3;
+
+    // reallocate myself
+    reallocate(newr, newc, namex);
+
+    // is ascii numbers?
+    if (magic[1]=='2' || magic[1]=='3') {
+        for (int r=0; r<maxr; r++) {
+            for (int c=0; c<maxc; c++) {
+                int tmp;
+                char bad;
+                if (readInt(IN, tmp, bad)!=1) {
+                    printf("ERROR(%s): Trying to read ascii pixel value at position (%d, %d) from file \"%s\" but failed.\n",
+                           caller.c_str(),
+                           r, c,
+                           filename.c_str());
+                    exit(1);
+                }
+                m[r][c] = tmp;
+            }
+        }
+    }
+
+    // is binary numbers?  Whole rows of bytes (two per value most
+    // significant first if max>255) are widened to doubles at once,
+    // straight from a memory map of a named file or read with one fread
+    // per row from stdin.
+    if (magic[1]=='5' || magic[1]=='6') {
+        int bytesPerValue = (max>255) ? 2 : 1;
+        size_t rowBytes = (size_t)bytesPerValue*maxc;
+        const unsigned char *data = NULL;
+        void *addr = MAP_FAILED;
+        size_t mapSize = 0;
+        struct stat info;
+        long start;
+
+        getc(IN);
+        start = ftell(IN);
+        if (IN!=stdin && start>=0 && fstat(fileno(IN), &info)==0 && (size_t)start<=(size_t)info.st_size) {
+            mapSize = info.st_size;
+            addr = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fileno(IN), 0);
+        }
+
+        if (addr!=MAP_FAILED) {
+            size_t have = mapSize - start;
+
+            madvise(addr, mapSize, MADV_SEQUENTIAL);
+            data = (const unsigned char *)addr + start;
+            if (have < rowBytes*maxr) {
+                printf("ERROR(%s): Trying to read a byte of pixel value at position (%d, %d) from file \"%s\" but got EOF.\n",
+                       caller.c_str(),
+                       int(have/rowBytes), int((have%rowBytes)/bytesPerValue),
+                       filename.c_str());
+                exit(1);
+            }
+        }
+
+        std::vector<unsigned char> buffer(addr==MAP_FAILED ? rowBytes : 0);
+        for (int r=0; r<maxr; r++) {
+            const unsigned char *bytes;
+            double *row = m[r];
+
+            if (addr!=MAP_FAILED) bytes = data + r*rowBytes;
+            else {
+                size_t got = fread(buffer.data(), 1, rowBytes, IN);
+
+                if (got!=rowBytes) {
+                    printf("ERROR(%s): Trying to read a byte of pixel value at position (%d, %d) from file \"%s\" but got EOF.\n",
+                           caller.c_str(),
+                           r, int(got/bytesPerValue),
+                           filename.c_str());
+                    exit(1);
+                }
+                bytes = buffer.data();
+            }
+
+            // simple loops so the compiler vectorizes the widening
+            if (bytesPerValue==1) for (int c=0; c<maxc; c++) row[c] = bytes[c];
+            else for (int c=0; c<maxc; c++) row[c] = (bytes[2*c]<<8) | bytes[2*c+1];
+        }
+
+        if (addr!=MAP_FAILED) munmap(addr, mapSize);
+    }
+
+    if (IN!=stdin) fclose(IN);
+    defined = true;
+
+    return *this;
+}
+
+
+
+// read in a netpbm format file (Only P2, P3, P5, or P6 magic numbers
+// will be accepted) from file named filename. If filename is the
+// empty string, "" then the data will be read from stdin. namex is
+// the name of the matrix created. isColor is a bool variable passed
+// in by reference and returns the whether the file was in ppm (color
+// which is P3 or P6) or pgm (gray-scale which is P2 or P5). If a
+// grayscale file is read, a matrix will be created with the numeric
+// value of each pixel and isColor will be set to false. If color, RGB
+// will be read in as 3 consecutive numbers in the matrix and isColor
+// will be set to true.
+Matrix &Matrix::readImagePixmap(std::string filename, std::string namex, bool& isColor)
+{
+    return readImage("2356", "readImagePixmap", filename, namex, isColor);  // accept types P2, P3, P5, or P6
+}
+
+
+// Read a pgm file  (8 bit gray scale) in P2 or P5 format.
+// WARNING: crudely assumes comments are less than 4K bytes
+Matrix &Matrix::readImagePgm(std::string filename, std::string namex)
+{
+    bool isColor;  // space holder
+    return readImage("25", "readImagePgm", filename, namex, isColor);  // accept types P2 or P5
+}
+
+
+// Read specifically a ppm (8 bit color) format file
+// WARNING: crudely assumes comments are less than 4K bytes
+Matrix &Matrix::readImagePpm(std::string filename, std::string namex)
+{
+    bool isColor;  // space holder
+    return readImage("36", "readImagePpm", filename, namex, isColor);  // accept types P3 or P6
+}
+
+
+
+// Write a pgm file  (8 bit gray scale)
+// It uses the readable character P2 representation of a picture, rather than
+// the binary P5 representation.  Line length is unrestricted.
+// WARNING: the user is entrusted with the task of using the pgm file extension
+// in the filename
+void Matrix::writeImagePgm(std::string filename, std::string comment)
+{
+    FILE *OUT;
+
+    assertDefined("writeImagePgm");
+    if (filename.length()>0) {
+        OUT = fopen(filename.c_str(), "w");
+        if (OUT==NULL) {
+            printf("ERROR(writeImagePgm): Trying to open file \"%s\" but failed.\n", filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        OUT = stdout;
+    }
+
+    fprintf(OUT, "P2\n");
+    if (name.length()>0) fprintf(OUT, "# Name: %s\n", name.c_str());
+    if (comment.length()>0) fprintf(OUT, "# %s\n", comment.c_str());
+    fprintf(OUT, "# 8 bit gray scale\n");
+    fprintf(OUT, "%d %d\n", maxc, maxr);        // NOTE: columns then rows!
+    fprintf(OUT, "255\n");                      // maximum level of gray
+    for (int r=0; r<maxr; r++) {
+        for (int c=0; c<maxc-1; c++) {
+            fprintf(OUT, "%d ", byteValue(m[r][c]));
+        }
+        fprintf(OUT, "%d\n", byteValue(m[r][maxc-1]));
+    }
+
+    fclose(OUT);
+}
+
+
+
+// Write a ppm file  (8 bit gray scale)
+// It uses the readable character P3 representation of a picture, rather than
+// the binary P6 representation.  Line length is unrestricted.
+// WARNING: the user is entrusted with the task of using the ppm file extension
+// in the filename
+void Matrix::writeImagePpm(std::string filename, std::string comment)
+{
+    FILE *OUT;
+
+    assertDefined("writeImagePpm");
+    if (maxc%3 != 0) {
+        if (name.length()==0) {
+            printf("ERROR(writeImagePpm): Number of columns %d not divisible by three but supposed to be a matrix of RGB values.\n", maxc);
+        }
+        else {
+            printf("ERROR(writeImagePpm): Number of columns %d in matrix named \"%s\" is not divisible by three but supposed to be a matrix of RGB values .\n", maxc, name.c_str());
+        }
+        exit(1);
+    }
+
+    if (filename.length()>0) {
+        OUT = fopen(filename.c_str(), "w");
+        if (OUT==NULL) {
+            printf("ERROR(writeImagePpm): Trying to open file \"%s\" but failed.\n", filename.c_str());
+            exit(1);
+        }
+    }
+    else {
+        OUT = stdout;
+    }
+
+    fprintf(OUT, "P3\n");
+    if (name.length()>0) fprintf(OUT, "# Name: %s\n", name.c_str());
+    if (comment.length()>0) fprintf(OUT, "# %s\n", comment.c_str());
+    fprintf(OUT, "# 8 bit color\n");
+    fprintf(OUT, "%d %d\n", maxc/3, maxr);      // NOTE: columns then rows!
+    fprintf(OUT, "255\n");                      // maximum level of color channels
+    for (int r=0; r<maxr; r++) {
+        for (int c=0; c<maxc-1; c++) {
+            fprintf(OUT, "%d ", byteValue(m[r][c]));
+        }
+        fprintf(OUT, "%d\n", byteValue(m[r][maxc-1]));
+    }
+
+    fclose(OUT);
+}
+
+
+// helper for writing a Matrix as a binary P5 or P6 file.  Each row is
+// clamped to bytes (see byteValue) and written with one fwrite.
+void Matrix::writeImageBinary(const char *caller, const char *magic, const char *kind, int width,
+                              std::string filename, std::string comment) const
+{
+    FILE *OUT;
+
+    OUT = writePixmapHeader(caller, magic, kind, filename, name, comment, width, maxr, 255);
+
+    std::vector<unsigned char> row(maxc);
+    for (int r=0; r<maxr; r++) {
+        for (int c=0; c<maxc; c++) row[c] = byteValue(m[r][c]);
+        fwrite(row.data(), 1, maxc, OUT);
+    }
+
+    if (OUT!=stdout) fclose(OUT);
+    else fflush(OUT);
+}
+
+
+// Write a pgm file (8 bit gray scale) in the binary P5 representation
+// which is about a quarter the size of P2 and far faster to read and
+// write.
+void Matrix::writeImagePgmBinary(std::string filename, std::string comment) const
+{
+    assertDefined("writeImagePgmBinary");
+
+    writeImageBinary("writeImagePgmBinary", "P5", "8 bit gray scale", maxc, filename, comment);
+}
+
+
+// Write a ppm file (8 bit color) in the binary P6 representation
+void Matrix::writeImagePpmBinary(std::string filename, std::string comment) const
+{
+    assertDefined("writeImagePpmBinary");
+    if (maxc%3 != 0) {
+        if (name.length()==0) {
+            printf("ERROR(writeImagePpmBinary): Number of columns %d not divisible by three but supposed to be a matrix of RGB values.\n", maxc);
+        }
+        else {
+            printf("ERROR(writeImagePpmBinary): Number of columns %d in matrix named \"%s\" is not divisible by three but supposed to be a matrix of RGB values .\n", maxc, name.c_str());
+        }
+        exit(1);
+    }
+
+    writeImageBinary("writeImagePpmBinary", "P6", "8 bit color", maxc/3, filename, comment);
+}
+
+
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+//  class CsrMatrix
+//
+//  a compressed sparse row matrix.  Row r has its nonzeros in
+//  colIndex and value at positions rowStart[r] to rowStart[r+1]-1 with
+//  the column indices in increasing order.  rowStart has maxr+1 entries.
+//
+
+// constructor for an undefined sparse matrix
+CsrMatrix::CsrMatrix(std::string namex)
+{
+    maxr = -1;
+    maxc = -1;
+    name = namex;
+}
+
+
+// constructor that converts a dense matrix, dropping elements whose
+// absolute value is <= epsilon (see fromMatrix)
+CsrMatrix::CsrMatrix(const Matrix &dense, double epsilon, std::string namex)
+{
+    maxr = -1;
+    maxc = -1;
+    name = (namex=="" ? dense.name : namex);
+    fromMatrix(dense, epsilon);
+}
+
+
+void CsrMatrix::assertDefined(std::string msg) const
+{
+    if (maxr<0) {
+        if (name.length()==0)
+            printf("ERROR(%s): sparse matrix is undefined\n", msg.c_str());
+        else
+            printf("ERROR(%s): sparse matrix \"%s\" is undefined\n", msg.c_str(), name.c_str());
+        exit(1);
+    }
+}
+
+
+void CsrMatrix::assertRowIndexOK(int r, std::string msg) const
+{
+    if (r<0 || r>=maxr) {
+        if (name.length()==0)
+            printf("ERROR(%s): row index %d is out of bounds for sparse matrix of size %d X %d\n",
+                   msg.c_str(), r, maxr, maxc);
+        else
+            printf("ERROR(%s): row index %d is out of bounds for sparse matrix \"%s\" of size %d X %d\n",
+                   msg.c_str(), r, name.c_str(), maxr, maxc);
+        exit(1);
+    }
+}
+
+
+// get an element.  This is a binary search of the row so it is
+// O(log(nonzeros in row)).  Elements not stored are zero.
+double CsrMatrix::get(int r, int c) const
+{
+    int lo, hi;
+
+    assertDefined("CsrMatrix::get");
+    assertRowIndexOK(r, "CsrMatrix::get");
+    if (c<0 || c>=maxc) {
+        printf("ERROR(CsrMatrix::get): column index %d is out of bounds for sparse matrix of size %d X %d\n", c, maxr, maxc);
+        exit(1);
+    }
+
+    lo = rowStart[r];
+    hi = rowStart[r+1]-1;
+    while (lo<=hi) {
+        int mid = (lo+hi)/2;
+
+        if (colIndex[mid]==c) return value[mid];
+        if (colIndex[mid]<c) lo = mid+1;
+        else hi = mid-1;
+    }
+
+    return 0.0;
+}
+
+
+// replace self with the elements of dense except those whose absolute
+// value is <= epsilon.  NaNs are kept so they are not lost as zeros.
+CsrMatrix &CsrMatrix::fromMatrix(const Matrix &dense, double epsilon)
+{
+    dense.assertDefined("CsrMatrix::fromMatrix");
+
+    maxr = dense.maxr;
+    maxc = dense.maxc;
+    rowStart.assign(1, 0);
+    colIndex.clear();
+    value.clear();
+
+    for (int r=0; r<maxr; r++) {
+        for (int c=0; c<maxc; c++) {
+            double x = dense.m[r][c];
+
+            if (!(fabs(x)<=epsilon)) {
+                colIndex.push_back(c);
+                value.push_back(x);
+            }
+        }
+        rowStart.push_back((int)value.size());
+    }
+
+    return *this;
+}
+
+
+// one-hot encode a matrix of symbol numbers such as is created by
+// readStrings.  Symbol numbers are expected to be in the range startNum
+// to startNum+numSymbols-1.  Column c of cat becomes the block of
+// numSymbols columns starting at c*numSymbols with a single 1 in it.
+// The result has exactly cat.numCols() nonzeros per row.
+CsrMatrix &CsrMatrix::oneHot(const Matrix &cat, int startNum, int numSymbols)
+{
+    cat.assertDefined("CsrMatrix::oneHot");
+    if ((long long)cat.maxr*cat.maxc>INT_MAX || (long long)cat.maxc*numSymbols>INT_MAX) {
+        printf("ERROR(CsrMatrix::oneHot): %d X %d matrix with %d symbols is too big to one-hot encode\n",
+               cat.maxr, cat.maxc, numSymbols);
+        exit(1);
+    }
+
+    maxr = cat.maxr;
+    maxc = cat.maxc*numSymbols;
+    rowStart.resize(maxr+1);
+    colIndex.resize((size_t)maxr*cat.maxc);
+    value.assign((size_t)maxr*cat.maxc, 1.0);
+
+    for (int r=0; r<maxr; r++) {
+        rowStart[r] = r*cat.maxc;
+        for (int c=0; c<cat.maxc; c++) {
+            int s = int(cat.m[r][c]) - startNum;
+
+            if (s<0 || s>=numSymbols || s+startNum!=cat.m[r][c]) {
+                printf("ERROR(CsrMatrix::oneHot): element [%d, %d] is %lg but must be an integer in the range %d to %d\n",
+                       r, c, cat.m[r][c], startNum, startNum+numSymbols-1);
+                exit(1);
+            }
+            colIndex[r*cat.maxc + c] = c*numSymbols + s;
+        }
+    }
+    rowStart[maxr] = maxr*cat.maxc;
+
+    return *this;
+}
+
+
+// expand into a dense matrix
+// WARNING: allocates new matrix for answer
+Matrix CsrMatrix::toMatrix() const
+{
+    assertDefined("CsrMatrix::toMatrix");
+
+    Matrix out(maxr, maxc, 0.0, name);
+
+    for (int r=0; r<maxr; r++) {
+        for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+            out.m[r][colIndex[i]] = value[i];
+        }
+    }
+
+    return out;
+}
+
+
+// sparse self times dense other.  Cost is nonzeros * other.numCols()
+// WARNING: allocates new matrix for answer
+Matrix CsrMatrix::dot(const Matrix &other) const
+{
+    assertDefined("lhs of CsrMatrix::dot");
+    other.assertDefined("rhs of CsrMatrix::dot");
+    if (maxc!=other.maxr) {
+        printf("ERROR(CsrMatrix::dot): sparse matrix of size %d X %d cannot be multiplied by matrix of size %d X %d\n",
+               maxr, maxc, other.maxr, other.maxc);
+        exit(1);
+    }
+
+    Matrix out(maxr, other.maxc, 0.0);
+
+    for (int r=0; r<maxr; r++) {
+        double *outRow = out.m[r];
+
+        for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+            double x = value[i];
+            double *otherRow = other.m[colIndex[i]];
+
+            for (int c=0; c<other.maxc; c++) {
+                outRow[c] += x * otherRow[c];
+            }
+        }
+    }
+
+    return out;
+}
+
+
+// Transpose(sparse self) times dense other.  Cost is nonzeros * other.numCols()
+// WARNING: allocates new matrix for answer
+Matrix CsrMatrix::Tdot(const Matrix &other) const
+{
+    assertDefined("lhs of CsrMatrix::Tdot");
+    other.assertDefined("rhs of CsrMatrix::Tdot");
+    if (maxr!=other.maxr) {
+        printf("ERROR(CsrMatrix::Tdot): transpose of sparse matrix of size %d X %d cannot be multiplied by matrix of size %d X %d\n",
+               maxr, maxc, other.maxr, other.maxc);
+        exit(1);
+    }
+
+    Matrix out(maxc, other.maxc, 0.0);
+
+    for (int r=0; r<maxr; r++) {
+        double *otherRow = other.m[r];
+
+        for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+            double x = value[i];
+            double *outRow = out.m[colIndex[i]];
+
+            for (int c=0; c<other.maxc; c++) {
+                outRow[c] += x * otherRow[c];
+            }
+        }
+    }
+
+    return out;
+}
+
+
+// dot product of row r of self with row otherRow of dense other
+double CsrMatrix::dotRow(int r, const Matrix &other, int otherRow) const
+{
+    double sum;
+    double *x;
+
+    assertDefined("CsrMatrix::dotRow");
+    assertRowIndexOK(r, "CsrMatrix::dotRow");
+    other.assertDefined("rhs of CsrMatrix::dotRow");
+    other.assertRowIndexOK(otherRow, "rhs of CsrMatrix::dotRow");
+    if (maxc!=other.maxc) {
+        printf("ERROR(CsrMatrix::dotRow): sparse matrix has %d columns but other matrix has %d\n", maxc, other.maxc);
+        exit(1);
+    }
+
+    x = other.m[otherRow];
+    sum = 0;
+    for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+        sum += value[i] * x[colIndex[i]];
+    }
+
+    return sum;
+}
+
+
+// SQUARE of distance between row r of self and the dense row y whose
+// square length is len2.  Uses
+// |x-y|^2 = |y|^2 + sum over nonzeros of x of (x-y)^2 - y^2
+// which can come out a hair below zero from rounding so it is clamped.
+double CsrMatrix::dist2RowAux(int r, const double *y, double len2) const
+{
+    double sum;
+
+    sum = len2;
+    for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+        double yy = y[colIndex[i]];
+        double tmp = value[i] - yy;
+
+        sum += tmp*tmp - yy*yy;
+    }
+
+    return sum<0.0 ? 0.0 : sum;
+}
+
+
+// SQUARE of distance between row r of self and row otherRow of dense other.
+double CsrMatrix::dist2Row(int r, const Matrix &other, int otherRow) const
+{
+    double len2;
+    double *y;
+
+    other.assertDefined("rhs of CsrMatrix::dist2Row");
+    other.assertRowIndexOK(otherRow, "rhs of CsrMatrix::dist2Row");
+
+    y = other.m[otherRow];
+    len2 = 0;
+    for (int c=0; c<other.maxc; c++) len2 += y[c]*y[c];
+
+    return dist2Row(r, other, otherRow, len2);
+}
+
+
+// same as above but with the square length of the row of other given
+// so a caller comparing many rows to it computes that only once
+double CsrMatrix::dist2Row(int r, const Matrix &other, int otherRow, double otherLen2) const
+{
+    assertDefined("CsrMatrix::dist2Row");
+    assertRowIndexOK(r, "CsrMatrix::dist2Row");
+    other.assertDefined("rhs of CsrMatrix::dist2Row");
+    other.assertRowIndexOK(otherRow, "rhs of CsrMatrix::dist2Row");
+    if (maxc!=other.maxc) {
+        printf("ERROR(CsrMatrix::dist2Row): sparse matrix has %d columns but other matrix has %d\n", maxc, other.maxc);
+        exit(1);
+    }
+
+    return dist2RowAux(r, other.m[otherRow], otherLen2);
+}
+
+
+// SQUARE of distance between row r of self and row otherRow of sparse
+// other.  This is a merge of the two rows so is O(nonzeros in the rows).
+double CsrMatrix::dist2Row(int r, const CsrMatrix &other, int otherRow) const
+{
+    double sum;
+    int i, j, iend, jend;
+
+    assertDefined("CsrMatrix::dist2Row");
+    assertRowIndexOK(r, "CsrMatrix::dist2Row");
+    other.assertDefined("rhs of CsrMatrix::dist2Row");
+    other.assertRowIndexOK(otherRow, "rhs of CsrMatrix::dist2Row");
+    if (maxc!=other.maxc) {
+        printf("ERROR(CsrMatrix::dist2Row): sparse matrix has %d columns but other sparse matrix has %d\n", maxc, other.maxc);
+        exit(1);
+    }
+
+    sum = 0;
+    i = rowStart[r];
+    iend = rowStart[r+1];
+    j = other.rowStart[otherRow];
+    jend = other.rowStart[otherRow+1];
+    while (i<iend || j<jend) {
+        double tmp;
+
+        if (j>=jend || (i<iend && colIndex[i]<other.colIndex[j])) tmp = value[i++];
+        else if (i>=iend || other.colIndex[j]<colIndex[i]) tmp = other.value[j++];
+        else tmp = value[i++] - other.value[j++];
+        sum += tmp*tmp;
+    }
+
+    return sum;
+}
+
+
+// SQUARE of distance of every row of self to row otherRow of dense other.
+// The length of the dense row is only computed once so the cost
+// is O(nonzeros + cols).
+// WARNING: allocates new matrix for answer
+Matrix CsrMatrix::dist2Rows(const Matrix &other, int otherRow) const
+{
+    double len2;
+    double *y;
+
+    assertDefined("CsrMatrix::dist2Rows");
+    other.assertDefined("rhs of CsrMatrix::dist2Rows");
+    other.assertRowIndexOK(otherRow, "rhs of CsrMatrix::dist2Rows");
+    if (maxc!=other.maxc) {
+        printf("ERROR(CsrMatrix::dist2Rows): sparse matrix has %d columns but other matrix has %d\n", maxc, other.maxc);
+        exit(1);
+    }
+
+    y = other.m[otherRow];
+    len2 = 0;
+    for (int c=0; c<maxc; c++) len2 += y[c]*y[c];
+
+    Matrix out(maxr, 1);
+    for (int r=0; r<maxr; r++) out.m[r][0] = dist2RowAux(r, y, len2);
+    out.defined = true;
+
+    return out;
+}
+
+
+// read a sparse matrix from stdin.  The format is:
+//  rows cols
+//  n col value col value ...     (n pairs for row 0)
+//  n col value col value ...     (n pairs for row 1)
+//  ...
+// columns within a row must be in increasing order.
+void CsrMatrix::read()
+{
+    int r, c;
+
+    if (scanf("%d %d", &r, &c)!=2 || r<0 || c<0) {
+        printf("ERROR(CsrMatrix::read): could not read a valid number of rows and columns\n");
+        exit(1);
+    }
+
+    maxr = r;
+    maxc = c;
+    rowStart.assign(1, 0);
+    colIndex.clear();
+    value.clear();
+
+    for (r=0; r<maxr; r++) {
+        int n, last;
+
+        if (scanf("%d", &n)!=1 || n<0 || n>maxc) {
+            printf("ERROR(CsrMatrix::read): invalid count of nonzeros at the start of row %d\n", r);
+            exit(1);
+        }
+
+        last = -1;
+        for (int i=0; i<n; i++) {
+            double x;
+
+            if (scanf("%d %lf", &c, &x)!=2) {
+                printf("ERROR(CsrMatrix::read): Trying to read nonzero %d of row %d but failed\n", i, r);
+                exit(1);
+            }
+            if (c<=last || c>=maxc) {
+                printf("ERROR(CsrMatrix::read): column %d in row %d is out of range or not in increasing order\n", c, r);
+                exit(1);
+            }
+            last = c;
+            colIndex.push_back(c);
+            value.push_back(x);
+        }
+        rowStart.push_back((int)value.size());
+    }
+}
+
+
+// write out in a form that can be read back in with read()
+void CsrMatrix::write() const
+{
+    assertDefined("CsrMatrix::write");
+
+    printf("%d %d\n", maxr, maxc);
+    for (int r=0; r<maxr; r++) {
+        printf("%d", rowStart[r+1]-rowStart[r]);
+        for (int i=rowStart[r]; i<rowStart[r+1]; i++) {
+            printf(" %d %.15lg", colIndex[i], value[i]);
+        }
+        printf("\n");
+    }
+}
+
+
+// just print the size, nonzero count and name of the matrix
+void CsrMatrix::printSize(std::string msg) const
+{
+    if (msg.length()) {
+        printf("%s ", msg.c_str());
+    }
+
+    if (name.length()) {
+        printf("(size of sparse %s: %d X %d with %d nonzeros)\n", name.c_str(), maxr, maxc, numNonZero());
+    }
+    else {
+        printf("(size of sparse: %d X %d with %d nonzeros)\n", maxr, maxc, numNonZero());
+    }
+
+    fflush(stdout);
+}
+
+
+
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+//  class ImageMatrix
+//
+//  compact 8 (or 16) bit storage of pgm/ppm images.  Pixels are stored
+//  row by row in a single vector so row r column c is at r*maxc + c.
+//  Only one of pix8 or pix16 is in use depending on maxval.
+//
+
+// constructor for an undefined image
+ImageMatrix::ImageMatrix(std::string namex)
+{
+    maxr = -1;
+    maxc = -1;
+    maxval = 255;
+    color = false;
+    name = namex;
+}
+
+
+// constructor that narrows a Matrix of pixel values (see fromMatrix)
+ImageMatrix::ImageMatrix(const Matrix &pixels, bool isColor, int newMaxval, std::string namex)
+{
+    maxr = -1;
+    maxc = -1;
+    name = (namex=="" ? pixels.name : namex);
+    fromMatrix(pixels, isColor, newMaxval);
+}
+
+
+// allocate space for r x c channel values all set to zero
+void ImageMatrix::allocate(int r, int c, int newMaxval)
+{
+    if (r<0 || c<0 || newMaxval<1 || newMaxval>65535) {
+        printf("ERROR(ImageMatrix::allocate): Trying to create an image of size %d X %d with maximum value %d\n", r, c, newMaxval);
+        exit(1);
+    }
+
+    maxr = r;
+    maxc = c;
+    maxval = newMaxval;
+    if (maxval>255) {
+        pix8.clear();
+        pix16.assign((size_t)r*c, 0);
+    }
+    else {
+        pix16.clear();
+        pix8.assign((size_t)r*c, 0);
+    }
+}
+
+
+// round down to an int and clamp into 0...maxval (same as Matrix::byteValue for 8 bits)
+int ImageMatrix::clampValue(double x) const
+{
+    int z;
+
+    z = int(x);
+    if (z<0) z = 0;
+    if (z>maxval) z = maxval;
+
+    return z;
+}
+
+
+void ImageMatrix::assertDefined(std::string msg) const
+{
+    if (maxr<0) {
+        if (name.length()==0)
+            printf("ERROR(%s): image is undefined\n", msg.c_str());
+        else
+            printf("ERROR(%s): image \"%s\" is undefined\n", msg.c_str(), name.c_str());
+        exit(1);
+    }
+}
+
+
+void ImageMatrix::assertColIndexOK(int c, std::string msg) const
+{
+    if (c<0 || c>=maxc) {
+        if (name.length()==0)
+            printf("ERROR(%s): column index %d is out of bounds for image of size %d X %d\n",
+                   msg.c_str(), c, maxr, maxc);
+        else
+            printf("ERROR(%s): column index %d is out of bounds for image \"%s\" of size %d X %d\n",
+                   msg.c_str(), c, name.c_str(), maxr, maxc);
+        exit(1);
+    }
+}
+
+
+// get the value of a channel
+int ImageMatrix::get(int r, int c) const
+{
+    assertDefined("ImageMatrix::get");
+    assertColIndexOK(c, "ImageMatrix::get");
+    if (r<0 || r>=maxr) {
+        printf("ERROR(ImageMatrix::get): row index %d is out of bounds for image of size %d X %d\n", r, maxr, maxc);
+        exit(1);
+    }
+
+    if (maxval>255) return pix16[(size_t)r*maxc + c];
+    return pix8[(size_t)r*maxc + c];
+}
+
+
+// set the value of a channel clamping into the range 0...maxval
+int ImageMatrix::set(int r, int c, int v)
+{
+    assertDefined("ImageMatrix::set");
+    assertColIndexOK(c, "ImageMatrix::set");
+    if (r<0 || r>=maxr) {
+        printf("ERROR(ImageMatrix::set): row index %d is out of bounds for image of size %d X %d\n", r, maxr, maxc);
+        exit(1);
+    }
+
+    v = clampValue(v);
+    if (maxval>255) pix16[(size_t)r*maxc + c] = v;
+    else pix8[(size_t)r*maxc + c] = v;
+
+    return v;
+}
+
+
+// widen column c into an array of numRows() doubles supplied by the caller
+void ImageMatrix::colToDouble(int c, double *out) const
+{
+    assertDefined("ImageMatrix::colToDouble");
+    assertColIndexOK(c, "ImageMatrix::colToDouble");
+    if (maxr==0) return;   // no pixels to point into
+
+    if (maxval>255) {
+        const unsigned short *p = &pix16[c];
+        for (int r=0; r<maxr; r++, p+=maxc) out[r] = *p;
+    }
+    else {
+        const unsigned char *p = &pix8[c];
+        for (int r=0; r<maxr; r++, p+=maxc) out[r] = *p;
+    }
+}
+
+
+// widen column c into an array of numRows() floats supplied by the caller
+void ImageMatrix::colToFloat(int c, float *out) const
+{
+    assertDefined("ImageMatrix::colToFloat");
+    assertColIndexOK(c, "ImageMatrix::colToFloat");
+    if (maxr==0) return;   // no pixels to point into
+
+    if (maxval>255) {
+        const unsigned short *p = &pix16[c];
+        for (int r=0; r<maxr; r++, p+=maxc) out[r] = *p;
+    }
+    else {
+        const unsigned char *p = &pix8[c];
+        for (int r=0; r<maxr; r++, p+=maxc) out[r] = *p;
+    }
+}
+
+
+// widen the columns minc to minc+sizec-1 into a new matrix
+// NOTE: zero size means "to the end of the row" like Matrix::extract
+// WARNING: allocates new matrix for answer
+Matrix ImageMatrix::extractCols(int minc, int sizec) const
+{
+    assertDefined("ImageMatrix::extractCols");
+    if (sizec==0) sizec = maxc - minc;
+    assertColIndexOK(minc, "lower bounds ImageMatrix::extractCols");
+    assertColIndexOK(minc+sizec-1, "upper bounds ImageMatrix::extractCols");
+
+    Matrix out(maxr, sizec, name);
+
+    for (int r=0; r<maxr; r++) {
+        double *outRow = out.m[r];
+        size_t base = (size_t)r*maxc + minc;
+
+        if (maxval>255) for (int c=0; c<sizec; c++) outRow[c] = pix16[base + c];
+        else for (int c=0; c<sizec; c++) outRow[c] = pix8[base + c];
+    }
+    out.defined = true;
+
+    return out;
+}
+
+
+// widen the whole image into a matrix just like Matrix::readImagePixmap would give
+// WARNING: allocates new matrix for answer
+Matrix ImageMatrix::toMatrix() const
+{
+    return extractCols(0, 0);
+}
+
+
+// narrow the columns of other back into self starting at column minc.
+// Values are clamped to 0...maxval.
+ImageMatrix &ImageMatrix::insertCols(const Matrix &other, int minc)
+{
+    assertDefined("ImageMatrix::insertCols");
+    other.assertDefined("ImageMatrix::insertCols");
+    assertColIndexOK(minc, "lower bounds ImageMatrix::insertCols");
+    assertColIndexOK(minc+other.maxc-1, "upper bounds ImageMatrix::insertCols");
+    if (other.maxr!=maxr) {
+        printf("ERROR(ImageMatrix::insertCols): image has %d rows but matrix to insert has %d rows\n", maxr, other.maxr);
+        exit(1);
+    }
+
+    for (int r=0; r<maxr; r++) {
+        double *otherRow = other.m[r];
+        size_t base = (size_t)r*maxc + minc;
+
+        if (maxval>255) for (int c=0; c<other.maxc; c++) pix16[base + c] = clampValue(otherRow[c]);
+        else for (int c=0; c<other.maxc; c++) pix8[base + c] = clampValue(otherRow[c]);
+    }
+
+    return *this;
+}
+
+
+// replace self with the pixel values in a matrix laid out as in
+// Matrix::readImagePixmap.  Values are clamped to 0...newMaxval.
+ImageMatrix &ImageMatrix::fromMatrix(const Matrix &pixels, bool isColor, int newMaxval)
+{
+    pixels.assertDefined("ImageMatrix::fromMatrix");
+    if (isColor && pixels.maxc%3!=0) {
+        printf("ERROR(ImageMatrix::fromMatrix): Number of columns %d not divisible by three but supposed to be a matrix of RGB values.\n", pixels.maxc);
+        exit(1);
+    }
+
+    allocate(pixels.maxr, pixels.maxc, newMaxval);
+    color = isColor;
+
+    return insertCols(pixels, 0);
+}
+
+
+// read a P2, P3, P5, or P6 file into self.  Binary formats are read
+// with a single fread straight into the pixel storage.
+ImageMatrix &ImageMatrix::readImagePixmap(std::string filename, std::string namex)
+{
+    char magic[3];               // magic number
+    FILE *IN;                    // input file
+    int newr, newc, max;         // picture parms
+
+    IN = readPixmapHeader("2356", "ImageMatrix::readImagePixmap", filename, magic, newr, newc, max);
+
+    color = (magic[1]=='3') || (magic[1]=='6');
+    if (color) newc *= 3;
+    allocate(newr, newc, max);
+    if (namex!="") name = namex;
+
+    // is ascii numbers?
+    if (magic[1]=='2' || magic[1]=='3') {
+        for (int r=0; r<maxr; r++) {
+            for (int c=0; c<maxc; c++) {
+                int tmp;
+                if (fscanf(IN, "%d", &tmp)!=1) {
+                    printf("ERROR(ImageMatrix::readImagePixmap): Trying to read ascii pixel value at position (%d, %d) from file \"%s\" but failed.\n",
+                           r, c,
+                           filename.c_str());
+                    exit(1);
+                }
+                if (tmp<0 || tmp>maxval) {
+                    printf("ERROR(ImageMatrix::readImagePixmap): ascii pixel value %d at position (%d, %d) in file \"%s\" is not in the range 0 to %d.\n",
+                           tmp, r, c, filename.c_str(), maxval);
+                    exit(1);
+                }
+                if (maxval>255) pix16[(size_t)r*maxc + c] = tmp;
+                else pix8[(size_t)r*maxc + c] = tmp;
+            }
+        }
+    }
+
+    // is binary numbers?  (16 bit values are most significant byte first)
+    if (magic[1]=='5' || magic[1]=='6') {
+        size_t size, got;
+
+        getc(IN);
+        size = (size_t)maxr*maxc;
+        if (maxval>255) {
+            std::vector<unsigned char> bytes(2*size);
+
+            got = fread(bytes.data(), 2, size, IN);
+            for (size_t i=0; i<got; i++) pix16[i] = (bytes[2*i]<<8) | bytes[2*i+1];
+        }
+        else {
+            got = fread(pix8.data(), 1, size, IN);
+        }
+
+        if (got!=size) {
+            printf("ERROR(ImageMatrix::readImagePixmap): Trying to read a byte of pixel value at position (%d, %d) from file \"%s\" but got EOF.\n",
+                   int(got/maxc), int(got%maxc),
+                   filename.c_str());
+            exit(1);
+        }
+
+        // the bytes can hold values above maxval (not possible if maxval is 255)
+        if (maxval!=255) {
+            for (size_t i=0; i<size; i++) {
+                int v = (maxval>255) ? pix16[i] : pix8[i];
+
+                if (v>maxval) {
+                    printf("ERROR(ImageMatrix::readImagePixmap): binary pixel value %d at position (%d, %d) in file \"%s\" is not in the range 0 to %d.\n",
+                           v, int(i/maxc), int(i%maxc), filename.c_str(), maxval);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    if (IN!=stdin) fclose(IN);
+
+    return *this;
+}
+
+
+// helper for writing a binary P5 or P6 file
+static void writePixmapBinary(const char *caller, const char *magic, const char *kind,
+                              std::string filename, std::string name, std::string comment,
+                              int width, int height, int maxval,
+                              const unsigned char *pix8, const unsigned short *pix16, int maxc)
+{
+    FILE *OUT;
+
+    OUT = writePixmapHeader(caller, magic, kind, filename, name, comment, width, height, maxval);
+
+    if (maxval>255) {
+        std::vector<unsigned char> row(2*(size_t)maxc);
+
+        for (int r=0; r<height; r++) {
+            for (int c=0; c<maxc; c++) {
+                unsigned short v = pix16[(size_t)r*maxc + c];
+                row[2*c] = v>>8;
+                row[2*c+1] = v&0xff;
+            }
+            fwrite(row.data(), 1, row.size(), OUT);
+        }
+    }
+    else {
+        fwrite(pix8, 1, (size_t)height*maxc, OUT);
+    }
+
+    if (OUT!=stdout) fclose(OUT);
+    else fflush(OUT);
+}
+
+
+// Write a binary P5 pgm file directly from the stored pixels
+void ImageMatrix::writeImagePgm(std::string filename, std::string comment) const
 {
-    double pythag(double a, double b);
-    int m, l, iter, i, k;
-    double s, r, p, g, f, dd, c, b;
+    assertDefined("ImageMatrix::writeImagePgm");
+    if (color) {
+        printf("ERROR(ImageMatrix::writeImagePgm): image is color.  Use writeImagePpm.\n");
+        exit(1);
+    }
 
-      // Convenient to renumber the elements of e.
-    for (i=1; i<n; i++) e[i-1]=e[i];
-    e[n-1]=0.0;
+    writePixmapBinary("ImageMatrix::writeImagePgm", "P5", maxval>255 ? "16 bit gray scale" : "8 bit gray scale",
+                      filename, name, comment, maxc, maxr, maxval, pix8.data(), pix16.data(), maxc);
+}
 
-    for (l=0; l<n; l++) {
-        iter=0;
-        do {
-            // Look for a single small subdiagonal element to split the matrix.
-            for (m=l; m<n-1; m++) {
-                dd=fabs(d[m])+fabs(d[m+1]);
-                if ((double)(fabs(e[m])+dd) == dd) break;
-            }
 
-            if (m != l) {
-                if (iter++ == 30) printf("Too many iterations in tqli");
-                g=(d[l+1]-d[l])/(2.0*e[l]);       // Form shift.
-                r=pythag(g, 1.0);
-                g=d[m]-d[l]+e[l]/(g+SIGN(r, g));       // This is dm - ks.
-                s=c=1.0;
-                p=0.0;
-                for (i=m-1; i>=l; i--) {      // A plane rotation as in the original QL, followed by Givens
-                    f=s*e[i];                // rotations to restore tridiagonal form.
-                    b=c*e[i];
-                    e[i+1]=(r=pythag(f, g));
-                    if (r == 0.0) {      // Recover from underflow.
-                        d[i+1] -= p;
-                        e[m]=0.0;
-                        break;
-                    }
-                    s=f/r;
-                    c=g/r;
-                    g=d[i+1]-p;
-                    r=(d[i]-g)*s+2.0*c*b;
-                    d[i+1]=g+(p=s*r);
-                    g=c*r-b;
-                    // Next loop can be omitted if eigenvectors not wanted
-                    // Form eigenvectors.
-                    for (k=0; k<n; k++) {
-                        f=z[k][i+1];
-                        z[k][i+1]=s*z[k][i]+c*f;
-                        z[k][i]=c*z[k][i]-s*f;
-                    }
-                }
-                if (r == 0.0 && i >= l) continue;
-                d[l] -= p;
-                e[l]=g;
-                e[m]=0.0;
-            }
-        } while (m != l);
+// Write a binary P6 ppm file directly from the stored pixels
+void ImageMatrix::writeImagePpm(std::string filename, std::string comment) const
+{
+    assertDefined("ImageMatrix::writeImagePpm");
+    if (maxc%3 != 0) {
+        printf("ERROR(ImageMatrix::writeImagePpm): Number of columns %d not divisible by three but supposed to be a matrix of RGB values.\n", maxc);
+        exit(1);
     }
+
+    writePixmapBinary("ImageMatrix::writeImagePpm", "P6", maxval>255 ? "16 bit color" : "8 bit color",
+                      filename, name, comment, maxc/3, maxr, maxval, pix8.data(), pix16.data(), maxc);
 }
 
 
-// ******************************************************************************
-// Computes (a2 + b2)1/2 without destructive underflow or overflow.
-//
-double pythag(double a, double b)
+// just print the size and name of the image
+void ImageMatrix::printSize(std::string msg) const
 {
-    double absa, absb;
-    absa=fabs(a);
-    absb=fabs(b);
-    if (absa > absb) return absa*sqrt(1.0+(absb/absa)*(absb/absa));
-    else return (absb == 0.0 ? 0.0 : absb*sqrt(1.0+(absa/absb)*(absa/absb)));
+    if (msg.length()) {
+        printf("%s ", msg.c_str());
+    }
+
+    if (name.length()) {
+        printf("(size of image %s: %d X %d max %d%s)\n", name.c_str(), maxr, maxc, maxval, color ? " color" : "");
+    }
+    else {
+        printf("(size of image: %d X %d max %d%s)\n", maxr, maxc, maxval, color ? " color" : "");
+    }
+
+    fflush(stdout);
 }
 
 
-// // // // // // // // // // // // // // // // // // // // // // // // // // // // // //
+
+// // // // // // // // // // // // // // // // // // // // // // // //
 //
-// translated from gaussj in Numerical Recipes in C, pg 36
+//  class MatrixView
 //
-// Linear equation solution by Gauss-Jordan elemination. a[0..n-1][0..n-1]
-// is an input matrix of n by n elements. b[0..n-1][0..m-1] is an input
-// matrix of n by m containing the m right-hand side vectors. On output, a is
-// replaced by its matrix inverse, and b is replaced by the corresponding set
-// of solution vectors.
+//  a zero copy selection of rows and columns of a Matrix.  Element
+//  (r, c) of the view is mat->m[rows[r]][cols[c]].
 //
-// returns true if successful and returns false if matrix is singular
-#define SWAP(a,b) {double temp=(a); (a)=(b); (b)=temp; }
-static bool gaussj(double **a, int n, double **b, int m)
+
+// all the views are constructed by the Matrix routines below
+MatrixView::MatrixView(const Matrix *parent, const std::vector<int> &rowList, const std::vector<int> &colList) :
+    mat(parent), rows(rowList), cols(colList)
 {
-    int *ipiv;
-    int *indxr, *indxc;
-    int i, j, k, l, ll;
-    int icol=-666, irow=-666;  // init these so uninitialized warning does not occur
-    double big, pivinv;
+}
 
-    // allocate some temp space for pivoting (in C++11 we could allocate in declaration)
-    // Jack A. suggests using a vector anyway.
-    ipiv = new int[n];
-    indxr = new int[n];
-    indxc = new int[n];
 
-    for (j=0; j<n; j++) ipiv[j] = 0;
+// helper: the list 0, 1, ... n-1
+static std::vector<int> allIndices(int n)
+{
+    std::vector<int> list(n);
 
-    // This is the main loop over the columns to be reduced
-    for (i=0; i<n; i++) {
-        big = 0.0;
+    for (int i=0; i<n; i++) list[i] = i;
 
-        // select the largest a[irow][icol]
-        for (j=0; j<n; j++) {
-            if (ipiv[j] != 1)  {
-                for (k=0; k<n; k++) {
-                    if (ipiv[k] == 0) {
-                        if (fabs(a[j][k]) >= big) {
-                            big = fabs(a[j][k]);
-                            irow = j;
-                            icol = k;
-                        }
-                    }
-                    else {
-                        if (ipiv[k] > 1) {
-                            printf("SYSTEM ERROR(gaussj): Singular Matrix type 1\n");
-                            fflush(stdout);
-                            return false;
-                        }
-                    }
-                }
-            }
+    return list;
+}
+
+
+// view of the columns listed in indices
+MatrixView Matrix::indexColsView(const int *indices, int sizeList) const
+{
+    assertDefined("indexColsView");
+
+    std::vector<int> colList(indices, indices+sizeList);
+    for (int i=0; i<sizeList; i++) {
+        if (indices[i]<0 || indices[i]>=maxc) {
+            printf("ERROR(indexColsView): index %d is out of bounds for input row vector of size %d\n", indices[i], maxc);
+            exit(1);
         }
-        ipiv[icol]++;
+    }
 
+    return MatrixView(this, allIndices(maxr), colList);
+}
 
-        // We now have the pivot element, so we intechange rows, if needed
-        // to put the pivot element on the diagonal. The columns are not
-        // physically interchanged, only relabeled: indxc[i], the column
-        // of the ith pivot element, is the ith column that is reduced, while
-        // indxr[i] is the row in which that pivot element was originally located.
-        // If indxr[i] != indxc[i] there is an implied column interchange.
-        // With this form of bookkeeping, the solution b's will end up in the
-        // correct order, and the inverse matrix will be scrambled by columns
-        if (irow != icol) {
-            for (l=0; l<n; l++) SWAP(a[irow][l],a[icol][l]);
-            for (l=0; l<m; l++) SWAP(b[irow][l],b[icol][l]);
+
+// view of the columns listed in the row vector rowOfIndices
+MatrixView Matrix::indexColsView(const Matrix &rowOfIndices) const
+{
+    assertDefined("indexColsView first arg");
+    rowOfIndices.assertDefined("indexColsView second arg");
+    rowOfIndices.assertRowVector("indexColsView second arg");
+
+    std::vector<int> colList(rowOfIndices.maxc);
+    for (int i=0; i<rowOfIndices.maxc; i++) {
+        colList[i] = int(rowOfIndices.m[0][i]);
+        if (colList[i]<0 || colList[i]>=maxc) {
+            printf("ERROR(indexColsView): index %d is out of bounds for input row vector of size %d\n", colList[i], maxc);
+            exit(1);
         }
+    }
 
-        // We are now ready to divide the pivot row by the pivot element
-        // located at irow and icol
-        indxr[i] = irow;
-        indxc[i] = icol;
-// zzz    catastrophic subtraction can happen with
-//        double data[] = {0, 1, 2, 3,
-//                 4, 5, 6, 7,
-//                 8, 9, 10, 11};
-//        printf("A: %lg\n", a[icol][icol]);
-//            fflush(stdout);
-        if (a[icol][icol] == 0.0) {
-            return false;   // matrix is singular!!
+    return MatrixView(this, allIndices(maxr), colList);
+}
+
+
+// view of the rows of self for which list[i]==match.  This is the
+// same selection as pickRows and subMatrixPickRows without any copying.
+// WARNING: number of rows could be zero.  User should check.
+MatrixView Matrix::pickRowsView(const Matrix &list, int match, int matchCol) const
+{
+    assertDefined("lhs of pickRowsView");
+    list.assertDefined("rhs of pickRowsView");
+    list.assertColVector("rhs of pickRowsView");
+    assertRowsEqual(list, "pickRowsView");
+    list.assertColIndexOK(matchCol, "rhs of pickRowsView");
+
+    std::vector<int> rowList;
+    for (int r=0; r<maxr; r++) {
+        if (list.m[r][matchCol]==match) rowList.push_back(r);
+    }
+
+    return MatrixView(this, rowList, allIndices(maxc));
+}
+
+
+// view whose row i is row perm[i] of self.  This applies a permutation
+// from the argsort routines lazily: nothing is moved or copied.
+MatrixView Matrix::permuteRowsView(const Matrix &perm) const
+{
+    assertDefined("permuteRowsView");
+    perm.assertPermutation(maxr, "permuteRowsView");
+
+    std::vector<int> rowList(maxr);
+    for (int r=0; r<maxr; r++) rowList[r] = int(perm.m[r][0]);
+
+    return MatrixView(this, rowList, allIndices(maxc));
+}
+
+
+// view of every stepr'th row and stepc'th column starting at (minr, minc)
+MatrixView Matrix::extractStrideView(int minr, int minc, int stepr, int stepc) const
+{
+    assertDefined("extractStrideView");
+    assertIndexOK(minr, minc, "lower bounds extractStrideView");
+    if (stepr<1 || stepc<1) {
+        printf("ERROR(extractStrideView): strides must be positive but are %d and %d\n", stepr, stepc);
+        exit(1);
+    }
+
+    std::vector<int> rowList, colList;
+    for (int r=minr; r<maxr; r+=stepr) rowList.push_back(r);
+    for (int c=minc; c<maxc; c+=stepc) colList.push_back(c);
+
+    return MatrixView(this, rowList, colList);
+}
+
+
+void MatrixView::assertOtherSizeMatch(const Matrix &other, std::string msg) const
+{
+    other.assertDefined(msg);
+    if (other.maxr!=numRows() || other.maxc!=numCols()) {
+        printf("ERROR(%s): view of size %d X %d does not match matrix of size %d X %d\n",
+               msg.c_str(), numRows(), numCols(), other.maxr, other.maxc);
+        exit(1);
+    }
+}
+
+
+// get the value of an element of the view
+double MatrixView::get(int r, int c) const
+{
+    if (r<0 || r>=numRows() || c<0 || c>=numCols()) {
+        printf("ERROR(MatrixView::get): index (%d, %d) is out of bounds for view of size %d X %d\n",
+               r, c, numRows(), numCols());
+        exit(1);
+    }
+
+    return mat->m[rows[r]][cols[c]];
+}
+
+
+// copy the view into a real matrix
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::materialize(std::string namex) const
+{
+    Matrix out(numRows(), numCols(), namex);
+
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+
+        for (int c=0; c<numCols(); c++) {
+            out.m[r][c] = row[cols[c]];
         }
+    }
+    out.defined = true;
 
-        pivinv = 1.0/a[icol][icol];
-        a[icol][icol] = 1.0;
-        for (l=0; l<n; l++) a[icol][l] *= pivinv;
-        for (l=0; l<m; l++) b[icol][l] *= pivinv;
+    return out;
+}
 
-        // next, we reduce the rows ...
-        // .. except for the pivot one, of course.
-        // DANGER: beware of catastrophic subtraction!!! -RH
-        for (ll=0; ll<n; ll++) {
-            if (ll != icol) {
-                double dum;
 
-                dum = a[ll][icol];
-                a[ll][icol] = 0.0;
-                for (l=0; l<n; l++) {
-                    a[ll][l] -= a[icol][l]*dum;
-                }
-                for (l=0; l<m; l++) {
-                    b[ll][l] -= b[icol][l]*dum;
-                }
-            }
+// sums up all the elements in the view
+double MatrixView::sum() const
+{
+    double sum;
 
-            //RH zzz put *real* test for catastrophic subtraction here.  This is totally bogus!!
-            if (fabs(a[ll][ll]) < 1E-14) a[ll][ll]=0;
-            //RH printf("LLA: %lg\n", a[ll][ll]);  // zzz
+    sum = 0;
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+
+        for (int c=0; c<numCols(); c++) {
+            sum += row[cols[c]];
         }
     }
 
-    // This is the end of the main loop over columns of the reduction.
-    // it only remains to unscramble the solution in view of the column
-    // interchanges. We do this by interchanging pairs of columns in the reverse
-    // order that the permutation was built.
-    for (l=n-1; l>=0; l--) {
-        if (indxr[l] != indxc[l]) {
-            for (k=0; k<n; k++) SWAP(a[k][indxr[l]], a[k][indxc[l]]);
+    return sum;
+}
+
+
+// mean of the whole view
+double MatrixView::mean() const
+{
+    if (numRows()==0 || numCols()==0) {
+        printf("ERROR(MatrixView::mean): view is empty\n");
+        exit(1);
+    }
+
+    return sum()/(double(numRows())*numCols());
+}
+
+
+// the mean of every column in a row vector
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::meanRowVectors() const
+{
+    if (numRows()==0) {
+        printf("ERROR(MatrixView::meanRowVectors): view has no rows\n");
+        exit(1);
+    }
+
+    Matrix out(1, numCols(), 0.0);
+    double *sum = out.m[0];
+
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+
+        for (int c=0; c<numCols(); c++) {
+            sum[c] += row[cols[c]];
         }
     }
+    for (int c=0; c<numCols(); c++) sum[c] /= numRows();
 
-    return true;
+    return out;
 }
 
 
+// SQUARE of distance between the view and a matrix of the same size
+double MatrixView::dist2(const Matrix &other) const
+{
+    double sum;
 
+    assertOtherSizeMatch(other, "MatrixView::dist2");
 
-// use this n^2 sort for small numbers of elements
-// to sort the rows of a matrix from rows numbered:
-// lower to upper inclusive
-void Matrix::selectSort(int lower, int upper)
-{
-    int bestLoc;
+    sum = 0;
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+        double *otherRow = other.m[r];
 
-    for (int l=lower; l<upper; l++) {
-        bestLoc = l;
-        for (int u=l+1; u<=upper; u++) {
-            if (isLessRows(u, bestLoc)) bestLoc=u;
+        for (int c=0; c<numCols(); c++) {
+            double tmp;
+
+            tmp = row[cols[c]] - otherRow[c];
+            sum += tmp * tmp;
         }
-        if (bestLoc!=l) swapRows(l, bestLoc);
     }
+
+    return sum;
 }
 
 
-// use this n^2 sort for small numbers of elements
-// to sort the rows of a matrix from rows numbered:
-// lower to upper inclusive
-void Matrix::selectSortCol(int c, int lower, int upper)
+// SQUARE of distance of each row of the view to row otherRow of other
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::dist2Rows(const Matrix &other, int otherRow) const
 {
-    int bestLoc;
+    other.assertDefined("rhs of MatrixView::dist2Rows");
+    other.assertRowIndexOK(otherRow, "rhs of MatrixView::dist2Rows");
+    if (other.maxc!=numCols()) {
+        printf("ERROR(MatrixView::dist2Rows): view has %d columns but other matrix has %d\n", numCols(), other.maxc);
+        exit(1);
+    }
 
-    for (int l=lower; l<upper; l++) {
-        bestLoc = l;
-        for (int u=l+1; u<=upper; u++) {
-            if (m[u][c] < m[bestLoc][c]) bestLoc=u;
+    Matrix out(numRows(), 1);
+    double *y = other.m[otherRow];
+
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+        double sum;
+
+        sum = 0;
+        for (int c=0; c<numCols(); c++) {
+            double tmp;
+
+            tmp = row[cols[c]] - y[c];
+            sum += tmp * tmp;
         }
-        if (bestLoc!=l) swapRows(l, bestLoc);
+        out.m[r][0] = sum;
     }
+    out.defined = true;
+
+    return out;
 }
 
 
-// do a quick sort of elements a[lower]...a[upper]
-void Matrix::qs(int lower, int upper)
+// dot of row r of the view with row otherRow of other
+double MatrixView::dotRow(int r, const Matrix &other, int otherRow) const
 {
-    int save;
+    double sum;
 
-    if (upper-lower<32) {
-        selectSort(lower, upper);
-        return;
+    other.assertDefined("rhs of MatrixView::dotRow");
+    other.assertRowIndexOK(otherRow, "rhs of MatrixView::dotRow");
+    if (r<0 || r>=numRows() || other.maxc!=numCols()) {
+        printf("ERROR(MatrixView::dotRow): row %d of view of size %d X %d cannot be dotted with a row of length %d\n",
+               r, numRows(), numCols(), other.maxc);
+        exit(1);
     }
 
-    save = lower;      // start scanning up with ptr from lower to upper
-    for (int ptr=lower; ptr<upper; ptr++) {
-        // keep shuffling the values less that split to be in the
-        // array indexed below save.
-        if (isLessRows(ptr, upper)) {
-            swapRows(save, ptr);
-            save++;
-        }
-    }
+    double *row = mat->m[rows[r]];
+    double *y = other.m[otherRow];
 
-    swapRows(upper, save);
+    sum = 0;
+    for (int c=0; c<numCols(); c++) {
+        sum += row[cols[c]] * y[c];
+    }
 
-    if (save-lower>1) qs(lower, save-1);
-    if (upper-save>1) qs(save+1, upper);
+    return sum;
 }
 
 
-// do a quick sort of elements a[lower]...a[upper]
-void Matrix::qsCol(int c, int lower, int upper)
+// matrix multiply of the view times other
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::dot(const Matrix &other) const
 {
-    int save;
-
-    if (upper-lower<32) {
-        selectSortCol(c, lower, upper);
-        return;
+    other.assertDefined("rhs of MatrixView::dot");
+    if (numCols()!=other.maxr) {
+        printf("ERROR(MatrixView::dot): view of size %d X %d cannot be multiplied by matrix of size %d X %d\n",
+               numRows(), numCols(), other.maxr, other.maxc);
+        exit(1);
     }
 
-    save = lower;      // start scanning up with ptr from lower to upper
-    for (int ptr=lower; ptr<upper; ptr++) {
-        // keep shuffling the values less that split to be in the
-        // array indexed below save.
-        if (m[ptr][c] < m[upper][c]) {
-            swapRows(save, ptr);
-            save++;
+    Matrix out(numRows(), other.maxc, 0.0);
+
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+        double *outRow = out.m[r];
+
+        for (int i=0; i<numCols(); i++) {
+            double x = row[cols[i]];
+            double *otherRow = other.m[i];
+
+            for (int c=0; c<other.maxc; c++) {
+                outRow[c] += x * otherRow[c];
+            }
         }
     }
 
-    swapRows(upper, save);
-
-    if (save-lower>1) qsCol(c, lower, save-1);
-    if (upper-save>1) qsCol(c, save+1, upper);
+    return out;
 }
 
 
-// sort the rows of a matrix.   WARNING: SORTS IN PLACE
-Matrix &Matrix::sortRows() {
-    assertDefined("sortRows");
-    if (maxr>1) qs(0, maxr-1);
+// matrix multiply of the view times the transpose of other
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::dotT(const Matrix &other) const
+{
+    other.assertDefined("rhs of MatrixView::dotT");
+    if (numCols()!=other.maxc) {
+        printf("ERROR(MatrixView::dotT): view has %d columns but other matrix has %d\n", numCols(), other.maxc);
+        exit(1);
+    }
 
-    return *this;
-}
+    Matrix out(numRows(), other.maxr);
 
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
 
+        for (int c=0; c<other.maxr; c++) {
+            double *otherRow = other.m[c];
+            double sum;
 
-// does a brute force selection sort but for k<<maxr this
-// is reasonable.   zzz a better way would be to use a
-// modified heapsort.  This would allow selection by heap.
-// That would be good for large maxr
-Matrix &Matrix::minKRowsByColSelf(int k, int c)
+            sum = 0;
+            for (int i=0; i<numCols(); i++) {
+                sum += row[cols[i]] * otherRow[i];
+            }
+            out.m[r][c] = sum;
+        }
+    }
+    out.defined = true;
+
+    return out;
+}
+
+
+// matrix multiply of the transpose of the view times other
+// WARNING: allocates new matrix for answer
+Matrix MatrixView::Tdot(const Matrix &other) const
 {
-    int bestLoc;
+    other.assertDefined("rhs of MatrixView::Tdot");
+    if (numRows()!=other.maxr) {
+        printf("ERROR(MatrixView::Tdot): view has %d rows but other matrix has %d\n", numRows(), other.maxr);
+        exit(1);
+    }
 
-    assertDefined("minKRowsByColSelf");
-    assertRowIndexOK(k-1, "minKRowsByColSelf");
-    assertColIndexOK(c, "minKRowsByColSelf");
+    Matrix out(numCols(), other.maxc, 0.0);
 
-    for (int l=0; l<k; l++) {
-        bestLoc = l;
-        for (int u=l+1; u<maxr; u++) {
-            if (m[u][c] < m[bestLoc][c]) bestLoc=u;
+    for (int r=0; r<numRows(); r++) {
+        double *row = mat->m[rows[r]];
+        double *otherRow = other.m[r];
+
+        for (int i=0; i<numCols(); i++) {
+            double x = row[cols[i]];
+            double *outRow = out.m[i];
+
+            for (int c=0; c<other.maxc; c++) {
+                outRow[c] += x * otherRow[c];
+            }
         }
-        if (bestLoc!=l) swapRows(l, bestLoc);
     }
 
-    return *this;
+    return out;
 }
 
 
 
-Matrix &Matrix::maxKRowsByColSelf(int k, int c)
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+//  class MatrixBuilder
+//
+//  rows[0]...rows[numr-1] each point to colCapacity doubles of which the
+//  first numc are in use.  Row pointers and row widths both grow by
+//  doubling.  The rows are allocated with new [] exactly like Matrix
+//  allocates them so they can be given to a Matrix as is.
+//
+
+MatrixBuilder::MatrixBuilder(int cols, std::string namex)
 {
-    int bestLoc;
+    rows = NULL;
+    numr = 0;
+    numc = cols;
+    rowCapacity = 0;
+    colCapacity = (cols>0 ? cols : 0);
+    name = namex;
+}
 
-    assertDefined("maxKRowsByColSelf");
-    assertRowIndexOK(k-1, "maxKRowsByColSelf");
-    assertColIndexOK(c, "maxKRowsByColSelf");
 
-    for (int l=0; l<k; l++) {
-        bestLoc = l;
-        for (int u=l+1; u<maxr; u++) {
-            if (m[u][c] > m[bestLoc][c]) bestLoc=u;
-        }
-        if (bestLoc!=l) swapRows(l, bestLoc);
-    }
+MatrixBuilder::~MatrixBuilder()
+{
+    release();
+}
 
-    return *this;
+
+// give back all the space
+void MatrixBuilder::release()
+{
+    if (rows!=NULL) {
+        for (int r=0; r<numr; r++) delete [] rows[r];
+        delete [] rows;
+    }
+    rows = NULL;
+    numr = 0;
+    rowCapacity = 0;
 }
 
 
-Matrix &Matrix::sortRows(int startRow, int endRow) {
-    assertDefined("sortRows");
-    assertRowIndexOK(startRow, "sortRows");
-    assertRowIndexOK(endRow, "sortRows");
-    assertArgNondecreasing(startRow, 1, endRow, 2, "sortRows");
-    if (maxr>1) qs(startRow, endRow);
+// make room for at least need row pointers
+void MatrixBuilder::growRows(int need)
+{
+    double **newRows;
 
-    return *this;
+    if (need<=rowCapacity) return;
+
+    rowCapacity = (rowCapacity<16 ? 16 : rowCapacity);
+    while (rowCapacity<need) rowCapacity *= 2;
+
+    newRows = new double * [rowCapacity];
+    for (int r=0; r<numr; r++) newRows[r] = rows[r];
+    delete [] rows;
+    rows = newRows;
 }
 
 
-// sort the rows of a matrix using column c as the key.
-// Column numbering starts at 0.
-// WARNING: sorts in place
-Matrix &Matrix::sortRowsByCol(int c) {
-    assertDefined("sortRowsCol");
-    assertColIndexOK(c, "sortRowsByCol");
-    if (maxr>1) qsCol(c, 0, maxr-1);
+// make room for at least need doubles in every row
+void MatrixBuilder::growCols(int need)
+{
+    if (need<=colCapacity) return;
 
-    return *this;
+    colCapacity = (colCapacity<4 ? 4 : colCapacity);
+    while (colCapacity<need) colCapacity *= 2;
+
+    for (int r=0; r<numr; r++) {
+        double *newRow = new double [colCapacity];
+
+        for (int c=0; c<numc; c++) newRow[c] = rows[r][c];
+        delete [] rows[r];
+        rows[r] = newRow;
+    }
 }
 
 
-// sort rows in place in a range of rows
-// Column numbering starts at 0.
-// WARNING: sorts in place
-Matrix &Matrix::sortRowsByCol(int c, int startRow, int endRow)
+// append a single row of numCols() values
+MatrixBuilder &MatrixBuilder::appendRow(const double *x)
 {
-    assertDefined("sortRowsByCol");
-    assertColIndexOK(c, "sortRowsByCol");
-    assertRowIndexOK(startRow, "sortRowsByCol");
-    assertRowIndexOK(endRow, "sortRowsByCol");
-    assertArgNondecreasing(startRow, 1, endRow, 2, "sortRowsByCol");
-    if (maxr>1) qsCol(c, startRow, endRow);
+    if (numc<0) {
+        printf("ERROR(MatrixBuilder::appendRow): the number of columns must be known before appending a raw row\n");
+        exit(1);
+    }
+
+    growRows(numr+1);
+    rows[numr] = new double [colCapacity];
+    for (int c=0; c<numc; c++) rows[numr][c] = x[c];
+    numr++;
 
     return *this;
 }
 
-// reverse the list of rows
-Matrix &Matrix::reverseRows()
+
+// append the rows of other to the bottom of what has been built so far.
+// If the width is not yet known it is taken from other.
+MatrixBuilder &MatrixBuilder::appendRows(const Matrix &other)
 {
-    int startRow = 0, endRow = maxr-1;
-    assertDefined("reverseRows");
-    
-    while (startRow < endRow) swapRows(startRow++, endRow--);
+    other.assertDefined("MatrixBuilder::appendRows");
+
+    if (numc<0) {
+        numc = other.maxc;
+        colCapacity = numc;
+    }
+    if (other.maxc!=numc) {
+        printf("ERROR(MatrixBuilder::appendRows): builder has %d columns but matrix appended has %d\n", numc, other.maxc);
+        exit(1);
+    }
+
+    growRows(numr+other.maxr);
+    for (int r=0; r<other.maxr; r++) {
+        rows[numr] = new double [colCapacity];
+        for (int c=0; c<numc; c++) rows[numr][c] = other.m[r][c];
+        numr++;
+    }
 
     return *this;
 }
 
 
-// reverse the list of rows of a given range of rows
-Matrix &Matrix::reverseRows(int startRow, int endRow)
+// append the columns of other to the right of what has been built so far.
+// If no rows have been built yet the number of rows is taken from other
+// and other's columns are the first columns, even if the builder was
+// given a width.
+MatrixBuilder &MatrixBuilder::appendCols(const Matrix &other)
 {
-    assertDefined("reverseRows");
-    assertRowIndexOK(startRow, "reverseRows");
-    assertRowIndexOK(endRow, "reverseRows");
-    assertArgNondecreasing(startRow, 1, endRow, 2, "reverseRows");
-    
-    while (startRow < endRow) swapRows(startRow++, endRow--);
+    other.assertDefined("MatrixBuilder::appendCols");
+
+    if (numr==0) {
+        numc = 0;
+        if (colCapacity<other.maxc) colCapacity = other.maxc;
+        growRows(other.maxr);
+        for (int r=0; r<other.maxr; r++) rows[r] = new double [colCapacity];
+        numr = other.maxr;
+    }
+    if (other.maxr!=numr) {
+        printf("ERROR(MatrixBuilder::appendCols): builder has %d rows but matrix appended has %d\n", numr, other.maxr);
+        exit(1);
+    }
+
+    growCols(numc+other.maxc);
+    for (int r=0; r<numr; r++) {
+        for (int c=0; c<other.maxc; c++) rows[r][numc+c] = other.m[r][c];
+    }
+    numc += other.maxc;
 
     return *this;
 }
 
 
-// Create a SUBMATRIX. DANGER: This bit of evil is a matrix that
-// POINTS INTO ANOTHER MATRIX! DANGER: Do not use the subMatrix after
-// you deallocate the other matrix!! In a sense this is not a real
-// matrix. If you want this matrix to persist then you have to make a
-// copy of it. It is great for efficiency. IMPORTANT: BE SURE to
-// deallocate this matrix before you deallocate the "mother matrix"
-Matrix Matrix::subMatrix(int minr, int minc, int sizer, int sizec) const
+// hand the rows over to out.  Rows are only copied if appendCols left
+// them wider than numc, to give back the spare space.  The builder is
+// left empty (but keeps its width) and can be used again.
+Matrix &MatrixBuilder::finalize(Matrix &out)
 {
-    if (sizer==0) sizer = maxr - minr;
-    if (sizec==0) sizec = maxc - minc;
+    out.deallocate();
+    if (numc<0) numc = 0;
 
-    assertIndexOK(minr, minc, "lower bounds submatrix extract");
-    assertIndexOK(minr+sizer-1, minc+sizec-1, "upper bounds submatrix extract");
-
-    Matrix out(sizer);                  // allocate a subMatrix!
-    out.maxc = sizec;                   // fix internal column width
+    if (colCapacity>numc) {
+        for (int r=0; r<numr; r++) {
+            double *newRow = new double [numc];
 
-    for (int r=0; r<sizer; r++) {
-        out.m[r] = &(m[minr][minc]);    // DANGER: we are copying pointers into other Matrix!!!
-        minr++;
+            for (int c=0; c<numc; c++) newRow[c] = rows[r][c];
+            delete [] rows[r];
+            rows[r] = newRow;
+        }
     }
 
+    if (rows==NULL) {
+        out.allocate(0, numc, name);
+    }
+    else {
+        out.m = rows;
+        out.maxr = numr;
+        out.maxc = numc;
+        out.submatrix = false;
+        if (name!="") out.name = name;
+        if (Matrix::debug) printf("DEBUG(  finalize): name \"%s\", size %d X %d\n", out.name.c_str(), numr, numc);
+    }
     out.defined = true;
 
+    rows = NULL;
+    numr = 0;
+    rowCapacity = 0;
+    colCapacity = numc;
+
     return out;
 }
 
 
-
-// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
-// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
-// deallocate the other matrix!!   In a sense this is not a real matrix.
-// If you want this matrix to persist then you have to make a full copy of it.
-// This will create a submatrix whose rows have value in column c.
-Matrix Matrix::subMatrixEq(int c, double value) const
+// move the rows into a new matrix
+// WARNING: allocates new matrix for answer
+Matrix MatrixBuilder::finalize()
 {
-    assertColIndexOK(c, "subMatrixEq");
+    Matrix out(name);
 
-    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
+    finalize(out);
 
-    for (int r=0; r<maxr; r++) {
-        if (m[r][c]==value) rowList.push_back(m[r]);
-    }
+    return out;
+}
 
-    Matrix out(rowList.size(), "sub" + name);                         // allocate a subMatrix!
-    out.maxc = maxc;                                                  // set size
 
-    for (unsigned int r=0; r<rowList.size(); r++) {
-        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
-    }
 
-    out.defined = true;
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+//  class MatrixJoinView
+//
+//  element (r, c) of the view is left->m[rows[r]][c] if c is less
+//  than the width of left else right->m[rows[r]][c - width of left].
+//
 
-    return out;
+MatrixJoinView::MatrixJoinView(const Matrix *leftMat, const Matrix *rightMat) :
+    left(leftMat), right(rightMat), rows(allIndices(leftMat->maxr))
+{
 }
 
 
-// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
-// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
-// deallocate the other matrix!!   In a sense this is not a real matrix.
-// If you want this matrix to persist then you have to make a full copy of it.
-// This will create a submatrix whose rows do not have value in column c.
-Matrix Matrix::subMatrixNeq(int c, double value) const
+// view of other joined on the right of self.  Nothing is copied.
+MatrixJoinView Matrix::joinRightView(const Matrix &other) const
 {
-    assertColIndexOK(c, "subMatrixNeq");
+    assertDefined("lhs of joinRightView");
+    other.assertDefined("rhs of joinRightView");
+    assertRowsEqual(other, "joinRightView");
 
-    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
+    return MatrixJoinView(this, &other);
+}
 
-    for (int r=0; r<maxr; r++) {
-        if (m[r][c]!=value) rowList.push_back(m[r]);
+
+int MatrixJoinView::numCols() const
+{
+    return left->maxc + right->maxc;
+}
+
+
+// get the value of an element of the view
+double MatrixJoinView::get(int r, int c) const
+{
+    if (r<0 || r>=numRows() || c<0 || c>=numCols()) {
+        printf("ERROR(MatrixJoinView::get): index (%d, %d) is out of bounds for view of size %d X %d\n",
+               r, c, numRows(), numCols());
+        exit(1);
     }
 
-    Matrix out(rowList.size(), "sub" + name);                         // allocate a subMatrix!
-    out.maxc = maxc;
+    if (c<left->maxc) return left->m[rows[r]][c];
+    return right->m[rows[r]][c-left->maxc];
+}
+
+
+// sort the rows of the view on column c by reordering the row list.
+// The sort is stable so ties stay in their original order.
+MatrixJoinView &MatrixJoinView::sortRowsByCol(int c)
+{
+    if (c<0 || c>=numCols()) {
+        printf("ERROR(MatrixJoinView::sortRowsByCol): column %d is out of bounds for view with %d columns\n", c, numCols());
+        exit(1);
+    }
+
+    const Matrix *mat = (c<left->maxc ? left : right);
+    int cc = (c<left->maxc ? c : c-left->maxc);
+
+    std::stable_sort(rows.begin(), rows.end(),
+                     [mat, cc](int a, int b) { return mat->m[a][cc] < mat->m[b][cc]; });
+
+    return *this;
+}
+
 
-    for (unsigned int r=0; r<rowList.size(); r++) {
-        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
+// keep only the first newr rows
+MatrixJoinView &MatrixJoinView::shorten(int newr)
+{
+    if (newr<0 || newr>numRows()) {
+        printf("ERROR(MatrixJoinView::shorten): can not shorten view with %d rows to %d rows\n", numRows(), newr);
+        exit(1);
     }
 
-    out.defined = true;
+    rows.resize(newr);
 
-    return out;
+    return *this;
 }
 
 
-// Create a subMatrix.   DANGER: This bit of evil is a matrix that POINTS
-// INTO ANOTHER MATRIX!   DANGER: Do not use the subMatrix after you
-// deallocate the other matrix!!   In a sense this is not a real matrix.
-// If you want this matrix to persist then you have to make a full copy of it.
-Matrix Matrix::subMatrixPickRows(const Matrix &list, int match, int matchCol)
+// copy the view into a real matrix
+// WARNING: allocates new matrix for answer
+Matrix MatrixJoinView::materialize(std::string namex) const
 {
-    assertDefined("lhs of subMatrixPickRows");
-    list.assertDefined("rhs of subMatrixPickRows");
-    list.assertColVector("rhs of subMatrixPickRows");
-    assertRowsEqual(list, "subMatrixPickRows");
-    list.assertColIndexOK(matchCol, "rhs of subMatrixPickRows");
+    Matrix out(numRows(), numCols(), namex);
 
-    std::vector<double *> rowList;        // this is a retrofit of using an array originally when vector better
-    for (int r=0; r<maxr; r++) {
-        if (list.m[r][matchCol]==match) rowList.push_back(m[r]);
+    for (int r=0; r<numRows(); r++) {
+        for (int c=0; c<left->maxc; c++) out.m[r][c] = left->m[rows[r]][c];
+        for (int c=0; c<right->maxc; c++) out.m[r][c+left->maxc] = right->m[rows[r]][c];
     }
+    out.defined = true;
 
-    if (rowList.size()==0) {
-        Matrix out("subMatrixPickRows Found No Rows In "+name);
+    return out;
+}
 
-        return out;
+
+// print the view exactly as Matrix::printLabeledRow would print the joined matrix
+void MatrixJoinView::printLabeledRow(const SymbolNumMap *labels,
+                                     int labelCol,
+                                     std::string msg,
+                                     bool size) const
+{
+    if (msg.length()) {
+        printf("%s ", msg.c_str());
+    }
+    if (size) {
+        printf("(size: %d X %d)\n", numRows(), numCols());
     }
 
-    Matrix out(rowList.size());                         // allocate a subMatrix!
-    out.maxc = maxc;
+    NumberFormat format(Matrix::realFormat);
+    OutBuffer out;
+    for (int r=0; r<numRows(); r++) {
+        for (int c=0; c<numCols(); c++) {
+            double x = (c<left->maxc ? left->m[rows[r]][c] : right->m[rows[r]][c-left->maxc]);
 
-    for (unsigned int r=0; r<rowList.size(); r++) {
-        out.m[r] = rowList[r];                          // DANGER: we are copying pointers into other Matrix!!!
+            if (c==labelCol) {
+                out.put(labels->getStr(x));
+                out.put(' ');
+            }
+            else {
+                format.put(out, x);
+            }
+        }
+        out.put('\n');
+        out.flush();
     }
+    out.flush();
 
-    out.defined = true;
-
-    return out;
+    fflush(stdout);
 }
 
 
 
-
-// // // // // // // // // // // // // // // // // // // //
+// // // // // // // // // // // // // // // // // // // // // // // //
 //
-// image (picture) support (currently just pgm files)
+//  class TopK
+//
+//  keys and ids form a binary heap in which every parent is no better
+//  than its children so the worst kept key is at keys[0].
 //
-// image (picture) support (currently only supports 8 bit pgm and ppm formats)
-// output is in ascii formats (zzz: fix someday to use more compressed output)
-// 8 bit gray is one integer in the range 0-255 for each pixel
-// 8 bit color is three integers in a row in the range 0-255 for RGB in each pixel.
-// That is an 8 bit color square 100x100 pixels gens a 100x300 dimensional array
 
-// helper routine for writing images
-int Matrix::byteValue(double x)
+TopK::TopK(int numToKeep, bool keepLargest)
 {
-    int z;
+    if (numToKeep<1) {
+        printf("ERROR(TopK): number of pairs to keep must be at least 1 but is %d\n", numToKeep);
+        exit(1);
+    }
 
-    z = int(x);
-    if (z<0) z = 0;
-    if (z>255) z = 255;
+    k = numToKeep;
+    largest = keepLargest;
+    sorted = false;
+    keys.reserve(k);
+    ids.reserve(k);
+}
 
-    return z;
+
+void TopK::clear()
+{
+    keys.clear();
+    ids.clear();
+    sorted = false;
 }
 
-// helper routine for reading images
-Matrix &Matrix::readImage(std::string expectedType,
-                         std::string caller,
-                         std::string filename,
-                         std::string namex,
-                         bool &isColor)
+
+// move element i down until it is no better than its children in the
+// heap made of the first n elements
+void TopK::siftDown(int i, int n)
 {
-    char magic[3];               // magic number
-    const int bufferSize=4096;   // buffer
-    char buffer[bufferSize];
-    FILE *IN;                    // input file
-    int newr, newc, max;               // picture parms
+    double key = keys[i];
+    int id = ids[i];
 
-    if (filename.length()>0) {
-        IN = fopen(filename.c_str(), "r");
-        if (IN==NULL) {
-            printf("ERROR(%s): Trying to open file \"%s\" but failed.\n", caller.c_str(), filename.c_str());
-            exit(1);
-        }
-    }
-    else {
-        IN = stdin;
+    for (;;) {
+        int child = 2*i+1;
+
+        if (child>=n) break;
+        if (child+1<n && better(keys[child], keys[child+1])) child++;   // the worse child
+        if (!better(key, keys[child])) break;
+        keys[i] = keys[child];
+        ids[i] = ids[child];
+        i = child;
     }
+    keys[i] = key;
+    ids[i] = id;
+}
 
-    // get magic number of file
-    if (fscanf(IN, "%2s", magic)!=1) {
-        if (filename.length()>0) {
-            printf("ERROR(%s): Unable to read file magic number for file named \"%s\".\n", caller.c_str(), filename.c_str());
-        }
-        else {
-            printf("ERROR(%s): Unable to read file magic number for file from stdin.\n", caller.c_str());
-        }
 
-        exit(1);
+// move element i up while it is worse than its parent
+void TopK::siftUp(int i)
+{
+    double key = keys[i];
+    int id = ids[i];
+
+    while (i>0) {
+        int parent = (i-1)/2;
+
+        if (!better(keys[parent], key)) break;
+        keys[i] = keys[parent];
+        ids[i] = ids[parent];
+        i = parent;
     }
+    keys[i] = key;
+    ids[i] = id;
+}
 
-    if (! (magic[0]=='P' && strisin(magic[1], expectedType.c_str()))) {
-        if (filename.length()>0) {
-            printf("ERROR(%s): Wrong magic number for file named \"%s\".  Expecting P%c or P%c format but had magic number: \"%c%c\".\n",
-                   caller.c_str(),
-                   filename.c_str(),
-                   expectedType[0],
-                   expectedType[1],
-                   magic[0],
-                   magic[1]);
-        }
-        else {
-            printf("ERROR(%s): Wrong magic number for file on stdin.  Expecting P%c or P%c format but had magic number: \"%c%c\".\n",
-                   caller.c_str(),
-                   expectedType[0],
-                   expectedType[1],
-                   magic[0],
-                   magic[1]);
-        }
 
-        exit(1);
+// offer a (key, id) pair.  It is kept if there are fewer than k pairs or
+// it is better than the worst kept pair which it then replaces.
+bool TopK::add(double key, int id)
+{
+    if (sorted) {
+        // best first order is not a heap so rebuild the heap
+        for (int i=(int)keys.size()/2-1; i>=0; i--) siftDown(i, (int)keys.size());
+        sorted = false;
     }
 
-    // read comment lines (Warning: assumes comments come right after magic number)
-    fscanf(IN, "%s", buffer);
-    while (*buffer=='#') {
-            fgets(buffer, bufferSize, IN);
-//            printf("# %s", buffer);
-            fscanf(IN, "%s", buffer);
+    if ((int)keys.size()<k) {
+        keys.push_back(key);
+        ids.push_back(id);
+        siftUp((int)keys.size()-1);
+        return true;
     }
 
-    // read picture parameters
-    newc = atoi(buffer);      // number of cols
-    fscanf(IN, "%d", &newr);  // number of rows
-    fscanf(IN, "%d", &max);   // maximum value for pixel
+    if (!better(key, keys[0])) return false;
 
-    // is color?
-    isColor = (magic[1]=='3') || (magic[1]=='6');
-    if (isColor) newc *= 3;
+    keys[0] = key;
+    ids[0] = id;
+    siftDown(0, (int)keys.size());
 
-    // reallocate myself
-    reallocate(newr, newc, namex);
+    return true;
+}
 
-    // is ascii numbers?
-    if (magic[1]=='2' || magic[1]=='3') {
-        for (int r=0; r<maxr; r++) {
-            for (int c=0; c<maxc; c++) {
-                int tmp;
-                if (fscanf(IN, "%d", &tmp)!=1) {
-                    printf("ERROR(%s): Trying to read ascii pixel value at position (%d, %d) from file \"%s\" but failed.\n",
-                           caller.c_str(),
-                           r, c,
-                           filename.c_str());
-                    exit(1);
-                }
-                m[r][c] = tmp;
-            }
-        }
+
+// the worst key kept
+double TopK::worstKey() const
+{
+    if (keys.size()==0) {
+        printf("ERROR(TopK::worstKey): no pairs have been added\n");
+        exit(1);
     }
 
-    // is binary numbers?
-    if (magic[1]=='5' || magic[1]=='6') {
-        getc(IN);
-        for (int r=0; r<maxr; r++) {
-            for (int c=0; c<maxc; c++) {
-                int byte;
-                byte = getc(IN);
-                if (byte==EOF) {
-                    printf("ERROR(%s): Trying to read a byte of pixel value at position (%d, %d) from file \"%s\" but got EOF.\n",
-                           caller.c_str(),
-                           r, c,
-                           filename.c_str());
-                    exit(1);
-                }
+    if (sorted) return keys[keys.size()-1];
+    return keys[0];
+}
 
-//                    if (feof(IN)) printf("ERROR() EOF\n");
-//                    if (ferror(IN)) {
-//                        printf("ERROR() ferror\n");
-//                        perror("What's up:");
-//                    }
-                m[r][c] = byte;
-            }
-        }
-    }
 
-    defined = true;
+// put the pairs in best first order (heapsort)
+void TopK::sort()
+{
+    int n = (int)keys.size();
 
-    return *this;
-}
+    if (sorted) return;
 
+    // repeatedly move the worst to the end of the shrinking heap
+    for (int end=n-1; end>0; end--) {
+        double tk = keys[0]; keys[0] = keys[end]; keys[end] = tk;
+        int ti = ids[0]; ids[0] = ids[end]; ids[end] = ti;
+        siftDown(0, end);
+    }
+    sorted = true;
+}
 
 
-// read in a netpbm format file (Only P2, P3, P5, or P6 magic numbers
-// will be accepted) from file named filename. If filename is the
-// empty string, "" then the data will be read from stdin. namex is
-// the name of the matrix created. isColor is a bool variable passed
-// in by reference and returns the whether the file was in ppm (color
-// which is P3 or P6) or pgm (gray-scale which is P2 or P5). If a
-// grayscale file is read, a matrix will be created with the numeric
-// value of each pixel and isColor will be set to false. If color, RGB
-// will be read in as 3 consecutive numbers in the matrix and isColor
-// will be set to true.
-Matrix &Matrix::readImagePixmap(std::string filename, std::string namex, bool& isColor)
+double TopK::key(int i) const
 {
-    return readImage("2356", "readImagePixmap", filename, namex, isColor);  // accept types P2, P3, P5, or P6
+    if (i<0 || i>=(int)keys.size()) {
+        printf("ERROR(TopK::key): index %d is out of range 0 to %d\n", i, (int)keys.size()-1);
+        exit(1);
+    }
+
+    return keys[i];
 }
 
 
-// Read a pgm file  (8 bit gray scale) in P2 or P5 format.
-// WARNING: crudely assumes comments are less than 4K bytes
-Matrix &Matrix::readImagePgm(std::string filename, std::string namex)
+int TopK::id(int i) const
 {
-    bool isColor;  // space holder
-    return readImage("25", "readImagePgm", filename, namex, isColor);  // accept types P2 or P5
+    if (i<0 || i>=(int)ids.size()) {
+        printf("ERROR(TopK::id): index %d is out of range 0 to %d\n", i, (int)ids.size()-1);
+        exit(1);
+    }
+
+    return ids[i];
 }
 
 
-// Read specifically a ppm (8 bit color) format file
-// WARNING: crudely assumes comments are less than 4K bytes
-Matrix &Matrix::readImagePpm(std::string filename, std::string namex)
+// the pairs as a matrix with columns key and id
+// WARNING: allocates new matrix for answer
+Matrix TopK::toMatrix(std::string namex) const
 {
-    bool isColor;  // space holder
-    return readImage("36", "readImagePpm", filename, namex, isColor);  // accept types P3 or P6
+    Matrix out(size(), 2, namex);
+
+    for (int i=0; i<size(); i++) {
+        out.set(i, 0, keys[i]);
+        out.set(i, 1, ids[i]);
+    }
+    out.setDefined();
+
+    return out;
 }
 
 
 
-// Write a pgm file  (8 bit gray scale)
-// It uses the readable character P2 representation of a picture, rather than
-// the binary P5 representation.  Line length is unrestricted.
-// WARNING: the user is entrusted with the task of using the pgm file extension
-// in the filename
-void Matrix::writeImagePgm(std::string filename, std::string comment)
+// // // // // // // // // // // // // // // // // // // // // // // //
+//
+// class MatrixRowReader
+//
+// reads a text matrix a row or chunk of rows at a time using the same
+// element readers as Matrix::readRaw
+//
+
+MatrixRowReader::MatrixRowReader(Matrix::ElementType elementType, SymbolNumMap *symbols, FILE *in)
 {
-    FILE *OUT;
+    IN = in;
+    ownsFile = false;
+    type = elementType;
+    syms = symbols;
+    numc = -1;
+    rowsLeft = -1;
+    numRead = 0;
 
-    assertDefined("writeImagePgm");
-    if (filename.length()>0) {
-        OUT = fopen(filename.c_str(), "w");
-        if (OUT==NULL) {
-            printf("ERROR(writeImagePgm): Trying to open file \"%s\" but failed.\n", filename.c_str());
-            exit(1);
-        }
+    // allocate a SymbolNumMap if needed but not supplied
+    if (syms==NULL && (type==Matrix::LABELEDROW || type==Matrix::STRINGS)) {
+        syms = new SymbolNumMap("", 1000);
     }
-    else {
-        OUT = stdout;
+}
+
+
+MatrixRowReader::MatrixRowReader(std::string filename, Matrix::ElementType elementType, SymbolNumMap *symbols) :
+    MatrixRowReader(elementType, symbols, NULL)
+{
+    IN = fopen(filename.c_str(), "r");
+    if (IN==NULL) {
+        printf("ERROR(MatrixRowReader): Trying to open file \"%s\" but failed.\n", filename.c_str());
+        exit(1);
     }
+    setvbuf(IN, NULL, _IOFBF, 1<<20);
+    ownsFile = true;
+}
 
-    fprintf(OUT, "P2\n");
-    if (name.length()>0) fprintf(OUT, "# Name: %s\n", name.c_str());
-    if (comment.length()>0) fprintf(OUT, "# %s\n", comment.c_str());
-    fprintf(OUT, "# 8 bit gray scale\n");
-    fprintf(OUT, "%d %d\n", maxc, maxr);        // NOTE: columns then rows!
-    fprintf(OUT, "255\n");                      // maximum level of gray
-    for (int r=0; r<maxr; r++) {
-        for (int c=0; c<maxc-1; c++) {
-            fprintf(OUT, "%d ", byteValue(m[r][c]));
-        }
-        fprintf(OUT, "%d\n", byteValue(m[r][maxc-1]));
+
+MatrixRowReader::~MatrixRowReader()
+{
+    if (ownsFile) fclose(IN);
+    IN = NULL;
+}
+
+
+// read the number of rows and columns at the start of a matrix in the
+// format Matrix::read takes.  The reader then stops after that many rows.
+// As with Matrix::read a matrix may have no rows or no columns.
+int MatrixRowReader::readHeader()
+{
+    int r, c;
+    char bad;
+
+    if (readInt(IN, r, bad)!=1 || readInt(IN, c, bad)!=1 || r<0 || c<0) {
+        printf("ERROR(MatrixRowReader): could not read a valid number of rows and columns\n");
+        exit(1);
     }
+    numc = c;
+    rowsLeft = r;
 
-    fclose(OUT);
+    return r;
 }
 
 
+// read rows of c values each until end of file (no header).  Rows of
+// no values would never reach the end of the file so c must be positive.
+void MatrixRowReader::setCols(int c)
+{
+    if (c<1) {
+        printf("ERROR(MatrixRowReader): number of columns must be positive: %d\n", c);
+        exit(1);
+    }
+    numc = c;
+    rowsLeft = -1;
+}
 
-// Write a ppm file  (8 bit gray scale)
-// It uses the readable character P3 representation of a picture, rather than
-// the binary P6 representation.  Line length is unrestricted.
-// WARNING: the user is entrusted with the task of using the ppm file extension
-// in the filename
-void Matrix::writeImagePpm(std::string filename, std::string comment)
+
+// read one row into x.  Running out of input before the row starts is
+// the end of the rows.  Running out in the middle of a row is an error.
+bool MatrixRowReader::readRow(double *x)
 {
-    FILE *OUT;
+    const int bufferSize=4096;   // buffer
+    char buffer[bufferSize];
+    std::string longToken;       // for strings too long for buffer
+    int numread;
+    char bad;
 
-    assertDefined("writeImagePpm");
-    if (maxc%3 != 0) {
-        if (name.length()==0) {
-            printf("ERROR(writeImagePpm): Number of columns %d not divisible by three but supposed to be a matrix of RGB values.\n", maxc);
+    if (numc<0) {
+        printf("ERROR(MatrixRowReader): call readHeader or setCols before reading rows\n");
+        exit(1);
+    }
+    if (rowsLeft==0) return false;
+
+    for (int c=0; c<numc; c++) {
+        if ((type==Matrix::LABELEDROW && c==0) || type==Matrix::STRINGS) {
+            numread = readToken(IN, buffer, bufferSize, &longToken);
+            if (numread!=EOF) x[c] = syms->add(numread>bufferSize-1 ? longToken.c_str() : buffer);
         }
         else {
-            printf("ERROR(writeImagePpm): Number of columns %d in matrix named \"%s\" is not divisible by three but supposed to be a matrix of RGB values .\n", maxc, name.c_str());
+            numread = readDouble(IN, x[c], bad);
+            if (numread==0) {
+                printf("ERROR(MatrixRowReader): invalid number when trying to read row: %d and col: %d.  First character is '%c'\n", numRead, c, bad);
+                exit(1);
+            }
         }
-        exit(1);
-    }
 
-    if (filename.length()>0) {
-        OUT = fopen(filename.c_str(), "w");
-        if (OUT==NULL) {
-            printf("ERROR(writeImagePpm): Trying to open file \"%s\" but failed.\n", filename.c_str());
+        if (numread==EOF) {
+            if (c==0 && rowsLeft<0) return false;
+            printf("ERROR(MatrixRowReader): Trying to read element [%d, %d] but end of file was found\n", numRead, c);
             exit(1);
         }
     }
-    else {
-        OUT = stdout;
+
+    numRead++;
+    if (rowsLeft>0) rowsLeft--;
+
+    return true;
+}
+
+
+// read the next row into row which is made 1 X numCols() if need be
+bool MatrixRowReader::nextRow(Matrix &row)
+{
+    if (row.maxr!=1 || row.maxc!=numc) row.reallocate(1, numc, row.name);
+    if (!readRow(row.m[0])) return false;
+    row.defined = true;
+
+    return true;
+}
+
+
+// read up to maxRows rows into chunk and return how many were read.
+// chunk is kept at maxRows X numCols() so it is reused from call to
+// call, except for a final short chunk which is cut to the rows read.
+int MatrixRowReader::nextChunk(Matrix &chunk, int maxRows)
+{
+    int n;
+
+    if (maxRows<1) {
+        printf("ERROR(MatrixRowReader): chunk size must be positive: %d\n", maxRows);
+        exit(1);
     }
+    if (chunk.maxr!=maxRows || chunk.maxc!=numc) chunk.reallocate(maxRows, numc, chunk.name);
 
-    fprintf(OUT, "P3\n");
-    if (name.length()>0) fprintf(OUT, "# Name: %s\n", name.c_str());
-    if (comment.length()>0) fprintf(OUT, "# %s\n", comment.c_str());
-    fprintf(OUT, "# 8 bit color\n");
-    fprintf(OUT, "%d %d\n", maxc/3, maxr);      // NOTE: columns then rows!
-    fprintf(OUT, "255\n");                      // maximum level of color channels
-    for (int r=0; r<maxr; r++) {
-        for (int c=0; c<maxc-1; c++) {
-            fprintf(OUT, "%d ", byteValue(m[r][c]));
+    n = 0;
+    while (n<maxRows && readRow(chunk.m[n])) n++;
+
+    if (n>0 && n<maxRows) {
+        Matrix last(n, numc, chunk.name);
+
+        for (int r=0; r<n; r++) {
+            for (int c=0; c<numc; c++) last.m[r][c] = chunk.m[r][c];
         }
-        fprintf(OUT, "%d\n", byteValue(m[r][maxc-1]));
+        last.defined = true;
+        chunk = last;
     }
+    else if (n>0) chunk.defined = true;
 
-    fclose(OUT);
+    return n;
 }
 
 
+
 // // // // // // // // // // // // // // // // // // // // // // // //
 //
 // Some random tests for the matrix code
@@ -5100,3 +9633,493 @@ int main()
 //    pic.readImagePgm("z.pgm", "mondrian").printInt();
 }
 */
+/*
+// benchmark of sortRowsByCol on random, sorted, reversed, and all equal keys
+// usage: ./a.out numRows
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *kind[4] = {"random", "sorted", "reverse", "equal"};
+    int n = atoi(argv[1]);
+
+    initRand();
+    for (int k=0; k<4; k++) {
+        Matrix a(n, 3);
+        double t;
+
+        a.rand(0.0, 1.0);
+        if (k==1) a.sortRowsByCol(0);
+        if (k==2) a.sortRowsByCol(0).reverseRows();
+        if (k==3) a.constantCol(0, 1.0);
+
+        t = seconds();
+        a.sortRowsByCol(0);
+        printf("%-8s %d rows: %.4lf sec\n", kind[k], n, seconds()-t);
+    }
+
+    return 0;
+}
+*/
+/*
+// benchmark of choosing the k best rows by a column: the old
+// selection sort, the heaps in minKRowsByColSelf and maxKRowsByColSelf,
+// partialSortRowsByCol and a TopK stream over the column
+// usage: ./a.out numRows
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the selection sort minKRowsByColSelf used to do
+static void oldMinKRowsByCol(Matrix &a, int k, int c)
+{
+    for (int l=0; l<k; l++) {
+        int bestLoc = l;
+
+        for (int u=l+1; u<a.numRows(); u++) {
+            if (a.get(u, c) < a.get(bestLoc, c)) bestLoc=u;
+        }
+        if (bestLoc!=l) a.swapRows(l, bestLoc);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int ks[4] = {1, 10, 100, 1000};
+    int n = atoi(argv[1]);
+    Matrix data(n, 3);
+
+    initRand();
+    data.rand(0.0, 1.0);
+
+    printf("%6s %10s %10s %10s %10s %10s\n", "k", "old", "heap min", "heap max", "partial", "TopK");
+    for (int i=0; i<4; i++) {
+        int k = ks[i];
+        double t, old, heap, heapMax, partial, stream;
+
+        Matrix a(data);
+        t = seconds();
+        oldMinKRowsByCol(a, k, 1);
+        old = seconds()-t;
+
+        Matrix b(data);
+        t = seconds();
+        b.minKRowsByColSelf(k, 1);
+        heap = seconds()-t;
+
+        Matrix e(data);
+        t = seconds();
+        e.maxKRowsByColSelf(k, 1);
+        heapMax = seconds()-t;
+
+        Matrix d(data);
+        t = seconds();
+        d.partialSortRowsByCol(k, 1);
+        partial = seconds()-t;
+
+        TopK top(k);
+        t = seconds();
+        for (int r=0; r<n; r++) top.add(data.get(r, 1), r);
+        top.sort();
+        stream = seconds()-t;
+
+        if (a.get(k-1, 1)!=b.get(k-1, 1) || b.get(k-1, 1)!=d.get(k-1, 1) || d.get(k-1, 1)!=top.key(k-1)) {
+            printf("ERROR: the methods disagree on the k-th smallest for k=%d\n", k);
+        }
+        printf("%6d %9.4lfs %9.4lfs %9.4lfs %9.4lfs %9.4lfs\n", k, old, heap, heapMax, partial, stream);
+    }
+
+    return 0;
+}
+*/
+/*
+// scaling benchmark of parallel sortRows from 1 thread to one per core
+// usage: ./a.out numRows
+#include <chrono>
+#include <thread>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    int cores = std::thread::hardware_concurrency();
+    Matrix data(n, 3);
+
+    initRand();
+    data.rand(0, 1000);
+    for (int threads=1; threads<=cores; threads*=2) {
+        Matrix a(data);
+        double t;
+
+        Matrix::sortThreads = threads;
+        t = seconds();
+        a.sortRows();
+        printf("%2d threads %d rows: %.4lf sec\n", threads, n, seconds()-t);
+    }
+
+    return 0;
+}
+*/
+/*
+// benchmark of radix sort against introsort for sortRowsByCol
+// usage: ./a.out numRows
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    Matrix data(n, 3);
+    double t;
+
+    initRand();
+    data.rand(0.0, 1.0);
+
+    Matrix a(data);
+    Matrix::radixSortMin = 0;
+    t = seconds();
+    a.sortRowsByCol(1);
+    printf("introsort %d rows: %.4lf sec\n", n, seconds()-t);
+
+    Matrix b(data);
+    t = seconds();
+    b.radixSortRowsByCol(1);
+    printf("radix     %d rows: %.4lf sec\n", n, seconds()-t);
+
+    return 0;
+}
+*/
+/*
+// benchmark of Matrix::read against a plain scanf("%lf") loop.  Run
+// once with the file on stdin and once with the file name
+// usage: ./a.out [file] < file
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    Matrix a;
+    double t;
+
+    t = seconds();
+    if (argc>1) {
+        int r, c;
+        double x, sum;
+        FILE *IN = fopen(argv[1], "r");
+
+        fscanf(IN, "%d %d", &r, &c);
+        sum = 0;
+        for (long long i=0; i<(long long)r*c; i++) {
+            fscanf(IN, "%lf", &x);
+            sum += x;
+        }
+        printf("scanf %d X %d: %.4lf sec (sum %lg)\n", r, c, seconds()-t, sum);
+        fclose(IN);
+    }
+
+    t = seconds();
+    a.read();
+    printf("read  %d X %d: %.4lf sec (sum %lg)\n", a.numRows(), a.numCols(), seconds()-t, a.sum());
+
+    return 0;
+}
+*/
+/*
+// convert a text matrix to the binary format and time reloading both
+// usage: ./a.out textFile binaryFile
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    Matrix a, b;
+    double t;
+
+    t = seconds();
+    a.read(argv[1]);
+    printf("read text   %d X %d: %.4lf sec\n", a.numRows(), a.numCols(), seconds()-t);
+
+    a.writeBinary(argv[2]);
+
+    t = seconds();
+    b.readBinary(argv[2]);
+    printf("read binary %d X %d: %.4lf sec\n", b.numRows(), b.numCols(), seconds()-t);
+
+    return 0;
+}
+*/
+/*
+// benchmark of text and binary image files on an image tiled up to
+// about 50 megapixels (e.g. ../ass03/bambooXuBeihong.pgm)
+// usage: ./a.out image.pgm
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    Matrix small, big, back;
+    bool isColor;
+    double t;
+
+    small.readImagePixmap(argv[1], "small", isColor);
+    if (isColor) {
+        printf("use a gray scale image\n");
+        return 1;
+    }
+
+    // tile the image to about 50 megapixels
+    int side = 7072;
+    big = Matrix(side, side, 0.0);
+    for (int r=0; r<side; r++) {
+        for (int c=0; c<side; c++) big.set(r, c, small.get(r%small.numRows(), c%small.numCols()));
+    }
+
+    t = seconds();
+    big.writeImagePgm("/tmp/big2.pgm", "P2");
+    printf("write P2 %d X %d: %.4lf sec\n", side, side, seconds()-t);
+    t = seconds();
+    big.writeImagePgmBinary("/tmp/big5.pgm", "P5");
+    printf("write P5 %d X %d: %.4lf sec\n", side, side, seconds()-t);
+
+    t = seconds();
+    back.readImagePgm("/tmp/big2.pgm", "back");
+    printf("read  P2 %d X %d: %.4lf sec\n", side, side, seconds()-t);
+    t = seconds();
+    back.readImagePgm("/tmp/big5.pgm", "back");
+    printf("read  P5 %d X %d: %.4lf sec\n", side, side, seconds()-t);
+
+    return 0;
+}
+*/
+/*
+// benchmark of print and write on a large matrix
+// usage: ./a.out numRows > /dev/null
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    Matrix a(n, 10);
+    double t;
+
+    initRand();
+    a.rand(-1000.0, 1000.0);
+
+    t = seconds();
+    a.print();
+    fprintf(stderr, "print %d X 10: %.4lf sec\n", n, seconds()-t);
+
+    t = seconds();
+    a.write();
+    fprintf(stderr, "write %d X 10: %.4lf sec\n", n, seconds()-t);
+
+    return 0;
+}
+*/
+/*
+// benchmark of reading a big text matrix serially and in parallel
+// usage: ./a.out numRows
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    Matrix a(n, 10), b, c;
+    double t;
+
+    initRand();
+    a.rand(-1000.0, 1000.0);
+    if (freopen("/tmp/big.txt", "w", stdout)==NULL) exit(1);
+    a.write();
+    fflush(stdout);
+
+    Matrix::readThreads = 1;
+    t = seconds();
+    b.read("/tmp/big.txt");
+    fprintf(stderr, "serial   read %d X 10: %.4lf sec\n", n, seconds()-t);
+
+    Matrix::readThreads = 0;
+    t = seconds();
+    c.read("/tmp/big.txt");
+    fprintf(stderr, "parallel read %d X 10: %.4lf sec\n", n, seconds()-t);
+
+    fprintf(stderr, "same: %d\n", b.equal(c));
+
+    return 0;
+}
+*/
+/*
+// benchmark of compressed binary matrix files: file size and time to
+// write and read a smooth image and a matrix of small integers
+// usage: ./a.out side
+#include <chrono>
+#include <math.h>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void trial(Matrix &a, const char *what)
+{
+    Matrix b;
+    struct stat info;
+    double t;
+
+    for (int compress=0; compress<2; compress++) {
+        t = seconds();
+        a.writeBinary("/tmp/big.matb", NULL, NULL, compress);
+        printf("%-8s %-10s write %.4lf sec", what, compress ? "compressed" : "plain", seconds()-t);
+        t = seconds();
+        b.readBinary("/tmp/big.matb");
+        stat("/tmp/big.matb", &info);
+        printf("  read %.4lf sec  %10lld bytes  same: %d\n", seconds()-t, (long long)info.st_size, a.equal(b));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int side = atoi(argv[1]);
+    Matrix image(side, side, 0.0), counts(side, side, 0.0);
+
+    initRand();
+    for (int r=0; r<side; r++) {
+        for (int c=0; c<side; c++) {
+            image.set(r, c, floor(128 + 100*sin(r/40.0)*cos(c/30.0) + randMod(4)));
+            counts.set(r, c, randMod(10));
+        }
+    }
+
+    trial(image, "image");
+    trial(counts, "counts");
+
+    return 0;
+}
+*/
+/*
+// benchmark of SymbolNumMap on a million row file of labels: reading
+// the file with readStrings and turning every entry back into a string
+// usage: ./a.out numRows numLabels
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    int labels = atoi(argv[2]);
+    SymbolNumMap *syms;
+    Matrix a;
+    FILE *OUT;
+    size_t len;
+    double t;
+
+    initRand();
+    OUT = fopen("/tmp/labels.txt", "w");
+    fprintf(OUT, "%d 3\n", n);
+    for (int r=0; r<n; r++) {
+        fprintf(OUT, "item_%08d category-%d class%d\n", randMod(labels), randMod(labels/10+1), randMod(8));
+    }
+    fclose(OUT);
+
+    if (freopen("/tmp/labels.txt", "r", stdin)==NULL) exit(1);
+    t = seconds();
+    syms = a.readStrings();
+    printf("readStrings %d X 3: %.4lf sec\n", n, seconds()-t);
+
+    t = seconds();
+    len = 0;
+    for (int r=0; r<a.numRows(); r++) {
+        for (int c=0; c<a.numCols(); c++) len += syms->getStr(a.get(r, c)).length();
+    }
+    printf("getStr of every entry: %.4lf sec (%lu chars)\n", seconds()-t, (unsigned long)len);
+
+    t = seconds();
+    len = 0;
+    for (int r=0; r<a.numRows(); r++) len += syms->getNum(syms->getStr(a.get(r, 0)))>=0;
+    printf("getNum of every label: %.4lf sec (%lu found)\n", seconds()-t, (unsigned long)len);
+
+    return 0;
+}
+*/
+/*
+// benchmark of filling a big matrix with random numbers
+// usage: ./a.out side
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int side = atoi(argv[1]);
+    Matrix a(side, side);
+    double t;
+
+    initRand();
+
+    t = seconds();
+    a.rand(-1.0, 1.0);
+    printf("rand(double) %d X %d: %.4lf sec\n", side, side, seconds()-t);
+
+    t = seconds();
+    a.randNorm(0.0, 1.0);
+    printf("randNorm     %d X %d: %.4lf sec\n", side, side, seconds()-t);
+
+    t = seconds();
+    a.rand(0, 100);
+    printf("rand(int)    %d X %d: %.4lf sec\n", side, side, seconds()-t);
+
+    return 0;
+}
+*/
+/*
+// benchmark of shuffling and sampling the rows of a big matrix
+// usage: ./a.out numRows
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    Matrix a(n, 2, 0.0), sample(n, 2);
+    double t;
+
+    initRand();
+    for (int r=0; r<n; r++) {
+        a.set(r, 0, r);
+        a.set(r, 1, -r);
+    }
+
+    t = seconds();
+    a.shuffle();
+    printf("shuffle %d rows: %.4lf sec\n", n, seconds()-t);
+
+    t = seconds();
+    sample.sampleRows(a);
+    printf("sampleRows %d rows: %.4lf sec\n", n, seconds()-t);
+
+    return 0;
+}
+*/
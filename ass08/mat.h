@@ -52,7 +52,6 @@
 #include <stdio.h>
 #include <vector>       // supports submatrices
 #include <string>       // matrix names are strings
-#include <map>          // for use in string to int mapping class
 #include "rand.h"       // portable random number generator.  Include exactly
                         // ONE of the random number cpp files in your compile
 //#define WALSH           // activate the Walsh library by defining this symbol
@@ -62,6 +61,9 @@ using namespace std;
 static const double EPSILONOFZERO=1E-8;
 
 class Matrix;
+class MatrixView;
+class MatrixJoinView;
+class MatrixRowReader;
 
 // bit counting operation used in the Walsh package but can't be put in .h file if used externally
 int bitCount(unsigned int w);   
@@ -77,6 +79,9 @@ int bitCount(unsigned int w);
 // both doubles and strings.
 // WARNING: Assumes the numbers associated with start at a fixed
 // number and are filled in increasing values with no gaps.
+// The strings are kept end to end in one arena with an open
+// addressing hash table for string to int and a vector of arena
+// offsets for int to string, so both directions are O(1).
 
 // helper class for mapping strings to ints and back
 class SymbolNumMap
@@ -86,8 +91,10 @@ private:
     int startNum;               // starting value (needed for error messages)
     string defaultMissing;      // default value returned if int is not in map
     int next;                   // next int to be assigned
-    map<string, int> strToNum;  // map string to int
-    map<int, string> numToStr;  // map int to string
+    vector<char> arena;         // the strings end to end
+    vector<size_t> offset;      // string n starts at offset[n-startNum] and ends at offset[n-startNum+1]
+    vector<unsigned int> hash;  // hash of string n at hash[n-startNum]
+    vector<int> slot;           // hash table of n-startNum or -1 if empty (size is a power of 2)
 
 public:
     SymbolNumMap(string name="", int startnum=0, string defaultValue="NONE");
@@ -101,6 +108,13 @@ public:
     string getStr(double x) const;     // get the string associated with x but test x and error if not valid
     void clear();
     void print(std::string msg="");
+
+private:
+    int add(const char *s, size_t len);
+    size_t findSlot(const char *s, size_t len, unsigned int h) const;
+    void rehash(size_t size);
+
+    friend class Matrix;        // binary matrix files save and restore the table
 };
 
 // // // // // // // // // // // // // // // //
@@ -143,15 +157,31 @@ public:
 //
 class Matrix {
 friend class MatrixRowIter;
+friend class CsrMatrix;
+friend class ImageMatrix;
+friend class MatrixView;
+friend class MatrixBuilder;
+friend class MatrixJoinView;
+friend class MatrixRowReader;
 
-enum ElementType {NUM, LABELEDROW, STRINGS};
+public:
+    enum ElementType {NUM, LABELEDROW, STRINGS};
+    enum MapAccess {NORMALACCESS, SEQUENTIALACCESS, RANDOMACCESS};   // madvise hint for mapped matrices
+    enum ColumnType {NUMERIC, CATEGORICAL, LABEL, IGNORED};          // column types for readCsv
 
 public:
     static bool debug;      // debugging flag
+    static int sortThreads;       // threads used by big sorts (0 means one per core, 1 means never parallel)
+    static int parallelSortMin;   // sorts of fewer rows than this are always done serially
+    static int radixSortMin;      // sorts by one column of at least this many rows (per thread if parallel) use radix sort (0 means never)
+    static int readThreads;       // threads used to parse big text files (0 means one per core, 1 means never parallel)
+    static int parallelReadMin;   // numeric text bodies of fewer bytes than this are always parsed serially
 
 protected:
     bool defined;           // does it have rows and cols defined
     bool submatrix;         // if submatrix then it does NOT own the row content of m (see deallocate)!!
+    void *mapped;           // if not NULL the rows point into this copy on write mapped file (see deallocate)
+    size_t mappedSize;      // size of the mapping
     int maxr, maxc;         // number of rows and columns (when not allocated they both have value -1)
     double **m;             // the data
     std::string name;       // the name of the matrix or ""
@@ -177,6 +207,7 @@ public:
     Matrix(int r, int c, int *data, std::string namex="");          // create and init from int array
     Matrix(const Matrix &other, std::string namex="");              // real COPY CONSTRUCTOR
     Matrix(Matrix *other);                                          // for convenience
+    Matrix(std::string filename, MapAccess access, std::string namex="");  // zero copy, copy on write map of a writeBinary file
     ~Matrix();
     Matrix &operator=(const Matrix &other);
 
@@ -203,6 +234,7 @@ public:
     void assertUsableSize(std::string msg) const;
     void assertArgNondecreasing(int arg1, int arg1loc, int arg2, int arg2loc, std::string msg) const;
     void assertRandInitialized(std::string msg) const;
+    void assertPermutation(int n, std::string msg) const;      // column vector holding a permutation of 0...n-1
 
 public:  // auxillary routines but not private (for speed, they do not check self!!)
     void swapRows(int i, int j);                  // utility to swap two rows
@@ -362,6 +394,16 @@ public:
     Matrix joinRight(Matrix &other);                  // joins other to the right of self giving NEW MATRIX
     Matrix joinBottom(Matrix &other);                 // joins other to the bottom of self giving NEW MATRIX
 
+    // ZERO COPY versions of the selections above.  These return a
+    // MatrixView that just remembers which rows and columns were selected
+    // (see class MatrixView).  The view must not outlive self.
+    MatrixView indexColsView(const int *indices, int sizeList) const;    // view of the listed columns
+    MatrixView indexColsView(const Matrix &rowOfIndices) const;          // view of columns listed in a row vector
+    MatrixView pickRowsView(const Matrix &list, int match, int matchCol=0) const;  // view of rows i where list[i]==match (see pickRows and subMatrixPickRows)
+    MatrixView permuteRowsView(const Matrix &perm) const;                // view with row i being row perm[i] (lazy applyPermutation)
+    MatrixView extractStrideView(int minr, int minc, int stepr, int stepc) const;  // view of every stepr row and stepc col
+    MatrixJoinView joinRightView(const Matrix &other) const;  // view of other joined on the right of self (see joinRight)
+
     // I/O  (bool size indicates if you want the matrix size printed as well);
     const Matrix &printFmt(std::string msg="", std::string fmt=realFormat, bool size=true);  // print matrix and optionally a msg with numbers in given format and with or without size
     const Matrix &print(std::string msg="", bool size=true, bool newline=true) const;         // print matrix and its name (returns arg for pipes)
@@ -390,6 +432,7 @@ public:
     // created. syms defaults to NULL forcing a create of a
     // SymbolNumMap for syms
     void read();                         // read in a numeric matrix where row and col are read in
+    void read(std::string filename);     // same as read() but from the named file
     void readT();                        // read in a numeric matrix and transpose it (just read that way)
     void readRaw();                      // read in a numeric matrix of size maxr, maxc
 //zzz    void readRawT();                     // read in a numeric matrix and transpose it (just read that way)
@@ -401,9 +444,36 @@ public:
     SymbolNumMap *readLabeledRow(SymbolNumMap *syms=NULL); // read in a matrix plus row labels
     SymbolNumMap *readStrings(SymbolNumMap *syms=NULL);    // read in a matrix which contains all strings updating symbol map
     SymbolNumMap *readRaw(ElementType labeled, SymbolNumMap *syms);
+    SymbolNumMap *readRaw(FILE *IN, ElementType labeled, SymbolNumMap *syms);  // same from an open file
+
+
+    // Binary matrix files (see writeBinary in mat.cpp for the layout).
+    // Values are stored as raw doubles so a reload runs at disk speed.
+    // Optionally a list of column names and a SymbolNumMap travel with
+    // the matrix.  The filename "" means stdin/stdout.  Compressed files
+    // are smaller for data like images or small integers but can't be mapped.
+    void writeBinary(std::string filename, const std::vector<std::string> *colNames=NULL,
+                     const SymbolNumMap *syms=NULL, bool compress=false) const;
+    SymbolNumMap *readBinary(std::string filename, std::vector<std::string> *colNames=NULL,
+                             SymbolNumMap *syms=NULL);   // replaces syms contents if file has a table
+    bool isMapped() const { return mapped!=NULL; }   // rows are in a mapped file
+
+    // CSV or TSV files with a type given for each column of the file.
+    // NUMERIC columns are read as numbers, CATEGORICAL and LABEL columns
+    // become numbers from syms and IGNORED columns are skipped.  The
+    // LABEL column (at most one) becomes column 0 as readLabeledRow
+    // does and the other kept columns follow in file order.
+    SymbolNumMap *readCsv(std::string filename, const std::vector<ColumnType> &schema,
+                          SymbolNumMap *syms=NULL, std::vector<std::string> *colNames=NULL,
+                          char separator=',', bool header=true);
 
 protected:
     SymbolNumMap *readAux(ElementType labeled, bool transpose, SymbolNumMap *syms);
+    SymbolNumMap *readAux(FILE *IN, ElementType labeled, bool transpose, SymbolNumMap *syms);
+    bool readRawParallel(FILE *IN);   // parse the numeric body of a big regular file with threads
+    SymbolNumMap *readBinaryHeader(FILE *IN, std::string filename, int &rows, int &cols, bool &swap,
+                                   bool &compressed, unsigned long long &checksum, std::vector<std::string> *colNames,
+                                   SymbolNumMap *syms);
 
 #ifdef WALSH
 // the Walsh analysis package (not default)
@@ -446,10 +516,8 @@ public:
 
     // sorting support (local helper functions)
 protected:
-    void selectSort(int lower, int upper);            // selection sort
-    void qs(int lower, int upper);                    // quick sort
-    void selectSortCol(int c, int lower, int upper);  // selection sort
-    void qsCol(int c, int lower, int upper);          // quick sort by a single column
+    void qs(int lower, int upper);                    // introsort using all columns
+    void qsCol(int c, int lower, int upper);          // introsort by a single column
 
     // sorting SMALLEST TO LARGEST!!!  (order by increasing value)
 public:
@@ -457,15 +525,33 @@ public:
     Matrix &sortRows(int startRow, int endRow);    // sort rows in place in a range of rows
     Matrix &sortRowsByCol(int c);                  // sort rows in place on given column
     Matrix &sortRowsByCol(int c, int startRow, int endRow);     // sort rows in place in a range of rows
+    Matrix &radixSortRowsByCol(int c);             // stable O(n) LSD radix sort on column c
+    Matrix &radixSortRowsByCol(int c, int startRow, int endRow);  // stable O(n) LSD radix sort on a range of rows
+    Matrix &sortRowsByCols(int numCols, const int *cols, const bool *descending=NULL);  // stable sort on several columns in order (descending[i] reverses column i)
+    Matrix uniqueRows() const;                     // sorted copy with duplicate rows removed
+    Matrix uniqueRowsByCols(int numCols, const int *cols) const;  // sorted copy keeping first row for each distinct value of the columns
     Matrix &reverseRows();                         // reverse the list of rows
     Matrix &reverseRows(int lower, int upper);     // reverse the list of rows
+    Matrix argsortByCol(int c) const;              // col vector of row numbers that would sort by column c (stable)
+    Matrix argsortRows() const;                    // col vector of row numbers that would sort rows using all columns (stable)
+    Matrix argsortByCols(int numCols, const int *cols, const bool *descending=NULL) const;  // same for sortRowsByCols (stable)
+    Matrix &applyPermutation(const Matrix &perm);  // reorder rows so row i is old row perm[i] (e.g. from argsort)
+    static void applyPermutation(const Matrix &perm, const std::vector<Matrix *> &mats);  // reorder several matrices together
+
+    // selection: partially sorts so that the given row k is in sorted position
+    // with smaller rows before it and larger rows after it (expected linear time)
+    Matrix &selectRowsByCol(int k, int c);                  // select over all rows
+    Matrix &selectRowsByCol(int k, int c, int lower, int upper);  // select within the range of rows lower to upper
+    double medianCol(int c) const;                 // median of column c (self not changed)
+    double percentileCol(int c, double p) const;   // value at fraction p of the way through sorted column c (self not changed)
 
 //zzz    Matrix &maxKRows(int k);                       // sort the max k values into highest indices
 
 //zzz    Matrix minKRowsByCol(int k, int c);       // sort the smallest k rows into first rows using column c
 //zzz    Matrix maxKRowsByCol(int k, int c);       // sort the largest k rows into first rows using column c
-    Matrix &minKRowsByColSelf(int k, int c);  // sort the smallest k rows into first rows using column c
-    Matrix &maxKRowsByColSelf(int k, int c);  // sort the largest k rows into first rows using column c
+    Matrix &minKRowsByColSelf(int k, int c);  // sort the smallest k rows into first rows using column c (heap, O(n log k))
+    Matrix &maxKRowsByColSelf(int k, int c);  // sort the largest k rows into first rows using column c (heap, O(n log k))
+    Matrix &partialSortRowsByCol(int k, int c);  // same result as minKRowsByColSelf using select then sort (O(n + k log k))
 
 public:
     // SUBMATRICES are here for EFFICIENCY for creating submatrices by pointing into
@@ -482,10 +568,12 @@ public:
     // 8 bit gray is one integer in the range 0-255 for each pixel
     // 8 bit color is three integers in a row in the range 0-255 for RGB in each pixel.
     // That is an 8 bit color square 100x100 pixels gens a 100x300 dimensional array
-    // The parameter in the format for maximum pixel value is currently not used.
+    // The maximum pixel value in the file is only used to tell one byte from two byte binary values.
 protected:
-    int byteValue(double x);
+    static int byteValue(double x);
     Matrix &readImage(std::string expectedType, std::string caller, std::string filename, std::string namex, bool &isColor);
+    void writeImageBinary(const char *caller, const char *magic, const char *kind, int width,
+                          std::string filename, std::string comment) const;
 
     // read and write images.   The first read function is the most general read.
 public:
@@ -494,7 +582,356 @@ public:
     Matrix &readImagePpm(std::string filename, std::string namex);   // read a P3 or P6 ppm  (8 bit color)
     void writeImagePgm(std::string filename, std::string comment);  // write a P2 pgm file  (8 bit gray scale)
     void writeImagePpm(std::string filename, std::string comment);  // write a P3 pgm file (8 bit color)
+    void writeImagePgmBinary(std::string filename, std::string comment) const;  // write a binary P5 pgm file (8 bit gray scale)
+    void writeImagePpmBinary(std::string filename, std::string comment) const;  // write a binary P6 ppm file (8 bit color)
 };
 
-#endif
 
+// // // // // // // // // // // // // // // //
+//
+// class CsrMatrix
+//
+// A compressed sparse row (CSR) matrix.  Only the nonzero elements
+// are stored: for each row the column index and value of each nonzero
+// element.  This is useful for one-hot encoded categorical data and
+// other sparse feature vectors where almost all of the elements are
+// zero.  The cost of dot products and distances is then proportional
+// to the number of nonzeros rather than the full width of the matrix.
+// It interoperates with Matrix by converting to and from it and by
+// multiplying against a dense Matrix.  Like Matrix the routines check
+// sizes and complain loudly.
+//
+class CsrMatrix {
+protected:
+    int maxr, maxc;               // number of rows and columns (-1 if undefined)
+    std::vector<int> rowStart;    // nonzeros of row r are at rowStart[r]...rowStart[r+1]-1
+    std::vector<int> colIndex;    // column of each nonzero
+    std::vector<double> value;    // value of each nonzero
+    std::string name;             // the name of the matrix or ""
+
+protected:
+    double dist2RowAux(int r, const double *y, double len2) const;   // no checks
+
+public:
+    CsrMatrix(std::string namex="");
+    CsrMatrix(const Matrix &dense, double epsilon=0.0, std::string namex="");  // convert from Matrix dropping |x|<=epsilon
+
+public:
+    void assertDefined(std::string msg) const;
+    void assertRowIndexOK(int r, std::string msg) const;
+
+// accessors
+public:
+    int numRows() const { return maxr; }
+    int numCols() const { return maxc; }
+    int numNonZero() const { return (int)value.size(); }
+    bool isDefined() const { return maxr>=0; }
+    double get(int r, int c) const;             // get element value (zero if not stored)
+    void setName(std::string newName) { name = newName; }
+    const std::string &getName() const { return name; }
+
+// building
+public:
+    CsrMatrix &fromMatrix(const Matrix &dense, double epsilon=0.0);  // replace self with nonzeros of dense
+    CsrMatrix &oneHot(const Matrix &cat, int startNum, int numSymbols);  // one-hot encode symbol numbers (see SymbolNumMap)
+    Matrix toMatrix() const;                    // expand into a NEW dense Matrix
+
+// arithmetic (these create a NEW MATRIX)
+public:
+    Matrix dot(const Matrix &other) const;      // sparse self * dense other -> dense
+    Matrix Tdot(const Matrix &other) const;     // Transpose(sparse self) * dense other -> dense
+    double dotRow(int r, const Matrix &other, int otherRow) const;   // dot of row r of self with a row of dense other
+    double dist2Row(int r, const Matrix &other, int otherRow) const; // *SQUARE* of distance from row r to a row of dense other
+    double dist2Row(int r, const Matrix &other, int otherRow, double otherLen2) const; // same given the square length of the other row
+    double dist2Row(int r, const CsrMatrix &other, int otherRow) const; // *SQUARE* of distance between two sparse rows
+    Matrix dist2Rows(const Matrix &other, int otherRow) const;  // *SQUARE* of distance of every row to a dense row -> col vector
+
+// I/O
+// The sparse format is the number of rows and columns followed by one
+// line per row: the number of nonzeros in the row and then that many
+// pairs of column index and value.
+public:
+    void read();                                // read in sparse format
+    void write() const;                         // write out in sparse format
+    void printSize(std::string msg="") const;   // print name, size and number of nonzeros
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class ImageMatrix
+//
+// Compact storage for pgm and ppm images.  Each pixel channel is kept
+// as the 8 bit value read from the file (or 16 bits if the maximum
+// pixel value is greater than 255) rather than as a double, which is
+// 8 times smaller than reading the image into a Matrix.  Columns are
+// laid out exactly as in Matrix::readImagePixmap: a color image has 3
+// columns (RGB) per pixel.  Columns are only widened to float or double
+// when they are asked for, so an algorithm can process a few columns
+// at a time and write the results back.
+//
+class ImageMatrix {
+protected:
+    int maxr, maxc;                 // number of rows and channel columns (-1 if undefined)
+    int maxval;                     // maximum pixel value (255 for 8 bit images)
+    bool color;                     // true if 3 channels per pixel (ppm)
+    std::vector<unsigned char> pix8;    // pixels if maxval <= 255 stored row by row
+    std::vector<unsigned short> pix16;  // pixels if maxval > 255 stored row by row
+    std::string name;               // the name of the image or ""
+
+protected:
+    void allocate(int r, int c, int newMaxval);
+    int clampValue(double x) const;
+
+public:
+    ImageMatrix(std::string namex="");
+    ImageMatrix(const Matrix &pixels, bool isColor, int newMaxval=255, std::string namex="");  // convert with clamping
+
+public:
+    void assertDefined(std::string msg) const;
+    void assertColIndexOK(int c, std::string msg) const;
+
+// accessors
+public:
+    int numRows() const { return maxr; }
+    int numCols() const { return maxc; }
+    int maxValue() const { return maxval; }
+    bool isColor() const { return color; }
+    bool isDefined() const { return maxr>=0; }
+    int get(int r, int c) const;              // get a channel value
+    int set(int r, int c, int v);             // set a channel value (clamped to 0...maxval)
+
+// widening to floating point (and narrowing back)
+public:
+    void colToDouble(int c, double *out) const;    // widen column c into an array of numRows() doubles
+    void colToFloat(int c, float *out) const;      // widen column c into an array of numRows() floats
+    Matrix extractCols(int minc, int sizec) const; // widen a range of columns into a NEW MATRIX
+    Matrix toMatrix() const;                       // widen the whole image into a NEW MATRIX
+    ImageMatrix &insertCols(const Matrix &other, int minc);    // narrow other back into columns starting at minc
+    ImageMatrix &fromMatrix(const Matrix &pixels, bool isColor, int newMaxval=255);  // replace self (clamping)
+
+// image file I/O
+// Reading accepts P2, P3, P5, and P6.  Writing is binary P5 (gray) or P6 (color)
+// straight from the stored pixels.  An empty filename means stdin/stdout.
+public:
+    ImageMatrix &readImagePixmap(std::string filename, std::string namex="");
+    void writeImagePgm(std::string filename, std::string comment) const;
+    void writeImagePpm(std::string filename, std::string comment) const;
+    void printSize(std::string msg="") const;
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class MatrixView
+//
+// A zero copy view of selected rows and columns of a Matrix.  It is
+// created by the Matrix routines indexColsView, pickRowsView, and
+// extractStrideView and holds only a list of row indices and a list of
+// column indices into the parent.  The distance, reduction and multiply
+// routines below read straight through the index lists so a selection
+// that is only used once never needs to be copied.  Call materialize()
+// to get a real Matrix.
+// DANGER: like a subMatrix, do not use a view after the parent Matrix
+// is deallocated or resized.
+//
+class MatrixView {
+protected:
+    const Matrix *mat;          // the parent matrix
+    std::vector<int> rows;      // rows of the parent in the view
+    std::vector<int> cols;      // columns of the parent in the view
+
+public:
+    MatrixView(const Matrix *parent, const std::vector<int> &rowList, const std::vector<int> &colList);
+
+public:
+    void assertOtherSizeMatch(const Matrix &other, std::string msg) const;
+
+// accessors
+public:
+    int numRows() const { return (int)rows.size(); }
+    int numCols() const { return (int)cols.size(); }
+    double get(int r, int c) const;                  // get element value
+    int parentRow(int r) const { return rows[r]; }   // row of the parent seen as row r
+    int parentCol(int c) const { return cols[c]; }   // column of the parent seen as column c
+    Matrix materialize(std::string namex="") const;  // copy the view into a NEW MATRIX
+
+// reductions
+public:
+    double sum() const;                              // sum of all the elements
+    double mean() const;                             // mean of all the elements
+    Matrix meanRowVectors() const;                   // row vector of means of columns -> NEW MATRIX
+
+// distances (beware that dist2 is square of the euclidean distance)
+public:
+    double dist2(const Matrix &other) const;         // *SQUARE* of distance to a matrix of the same size
+    Matrix dist2Rows(const Matrix &other, int otherRow) const;  // *SQUARE* of distance of each row to a row of other -> col vector
+    double dotRow(int r, const Matrix &other, int otherRow) const;  // dot of row r with a row of other
+
+// multiplies (these create a NEW MATRIX)
+public:
+    Matrix dot(const Matrix &other) const;           // view * other
+    Matrix dotT(const Matrix &other) const;          // view * Transpose(other)
+    Matrix Tdot(const Matrix &other) const;          // Transpose(view) * other
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class MatrixBuilder
+//
+// Accumulates a matrix a row or a block of rows (or a block of
+// columns) at a time.  Use this instead of repeatedly doing
+// r = r.joinBottom(y) or r = r.joinRight(y) which copies the whole
+// matrix on every append.  Space grows by doubling so appending is
+// amortized constant time per element.  finalize() hands the rows that
+// were built over to a Matrix and empties the builder.  Rows built by
+// appending rows are not copied; rows widened by appendCols are copied
+// once to trim their spare space.
+//
+class MatrixBuilder {
+protected:
+    double **rows;          // the rows built so far (rowCapacity row pointers)
+    int numr, numc;         // number of rows and columns built so far (numc -1 until known)
+    int rowCapacity;        // number of row pointers allocated
+    int colCapacity;        // number of doubles allocated in each row
+    std::string name;       // name given to the finished matrix
+
+protected:
+    void growRows(int need);
+    void growCols(int need);
+    void release();
+
+public:
+    MatrixBuilder(int cols=-1, std::string namex="");   // cols<0 means take the width from the first append
+    ~MatrixBuilder();
+    MatrixBuilder(const MatrixBuilder &other) = delete;              // the rows are owned so no copies
+    MatrixBuilder &operator=(const MatrixBuilder &other) = delete;
+
+public:
+    int numRows() const { return numr; }
+    int numCols() const { return numc; }
+    MatrixBuilder &appendRow(const double *x);        // append one row of numCols() values
+    MatrixBuilder &appendRows(const Matrix &other);   // append rows to the bottom (like joinBottom)
+    MatrixBuilder &appendCols(const Matrix &other);   // append columns to the right (like joinRight, the first block sets the rows)
+    Matrix finalize();                                // move the rows into a NEW MATRIX and empty the builder
+    Matrix &finalize(Matrix &out);                    // move the rows into out (replacing its contents)
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class MatrixJoinView
+//
+// A zero copy view of two matrices with the same number of rows joined
+// side by side, as if joinRight had been called.  The rows of the view
+// can be sorted and trimmed by reordering a list of row indices, so a
+// distance column can be joined to a large list, sorted, and the first
+// k rows printed without copying the list.  Create with Matrix::joinRightView.
+// DANGER: do not use the view after either matrix is deallocated.
+//
+class MatrixJoinView {
+protected:
+    const Matrix *left;         // left matrix
+    const Matrix *right;        // right matrix
+    std::vector<int> rows;      // rows of the two matrices in the order they appear in the view
+
+public:
+    MatrixJoinView(const Matrix *leftMat, const Matrix *rightMat);
+
+public:
+    int numRows() const { return (int)rows.size(); }
+    int numCols() const;
+    double get(int r, int c) const;                  // get element value
+    int parentRow(int r) const { return rows[r]; }   // row in the joined matrices seen as row r
+    MatrixJoinView &sortRowsByCol(int c);            // sort the rows of the view SMALLEST TO LARGEST on column c
+    MatrixJoinView &shorten(int newr);               // keep only the first newr rows of the view
+    Matrix materialize(std::string namex="") const;  // copy the view into a NEW MATRIX
+    void printLabeledRow(const SymbolNumMap *labels, int labelCol=0, std::string msg="", bool size=true) const;  // same output as Matrix::printLabeledRow
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class TopK
+//
+// Streaming accumulator of the k best (key, id) pairs.  Pairs are added
+// one at a time so no column of keys needs to exist.  For example in
+// nearest neighbor search add(distance, row) for each row of a list
+// and only the k closest are kept.  If largest is false the k smallest
+// keys are kept otherwise the k largest.  Cost is O(log k) for each pair
+// that makes it into the best k and O(1) for the rest.
+//
+class TopK {
+protected:
+    int k;                      // how many to keep
+    bool largest;               // keep largest keys rather than smallest
+    std::vector<double> keys;   // heap of keys with the worst kept key on top
+    std::vector<int> ids;       // id that goes with each key
+    bool sorted;                // true if in best first order rather than heap order
+
+protected:
+    bool better(double a, double b) const { return largest ? a>b : a<b; }
+    void siftDown(int i, int n);    // in the heap of the first n pairs
+    void siftUp(int i);
+
+public:
+    TopK(int numToKeep, bool keepLargest=false);
+
+public:
+    void clear();                          // empty the accumulator
+    bool add(double key, int id);          // offer a pair.  Returns true if it was kept
+    bool full() const { return (int)keys.size()==k; }
+    int size() const { return (int)keys.size(); }
+    double worstKey() const;               // the worst key kept (the bound a new key must beat when full)
+    void sort();                           // order best first so key(0) is the best.  Adding again reheaps.
+    double key(int i) const;               // key i (call sort() first for best-first order)
+    int id(int i) const;                   // id i (call sort() first for best-first order)
+    Matrix toMatrix(std::string namex="") const;  // NEW MATRIX with columns (key, id) in the current order
+};
+
+
+// // // // // // // // // // // // // // // //
+//
+// class MatrixRowReader
+//
+// Reads a matrix a row or a chunk of rows at a time as the text arrives
+// rather than all at once like Matrix::read, so a program answering
+// queries can answer the first before the last has been typed and only
+// ever holds one chunk in memory.  The input is either in the format
+// Matrix::read takes (call readHeader first) or, for an unbounded
+// stream, just rows of setCols() values each until end of file.
+// Elements are read as numbers, a string label followed by numbers, or
+// all strings just as for read, readLabeledRow and readStrings.
+//
+class MatrixRowReader {
+protected:
+    FILE *IN;                   // where rows come from
+    bool ownsFile;              // close IN when done
+    Matrix::ElementType type;   // how to read elements
+    SymbolNumMap *syms;         // map for strings (if any)
+    int numc;                   // values in each row
+    int rowsLeft;               // rows still to come or -1 if to end of file
+    int numRead;                // rows read so far
+
+protected:
+    bool readRow(double *x);    // read one row of numc values.  false if there are no more rows
+
+public:
+    MatrixRowReader(Matrix::ElementType elementType=Matrix::NUM, SymbolNumMap *symbols=NULL, FILE *in=stdin);
+    MatrixRowReader(std::string filename, Matrix::ElementType elementType=Matrix::NUM, SymbolNumMap *symbols=NULL);
+    ~MatrixRowReader();
+    MatrixRowReader(const MatrixRowReader &other) = delete;              // a copy would close the file twice
+    MatrixRowReader &operator=(const MatrixRowReader &other) = delete;
+
+public:
+    int readHeader();                           // read the "rows cols" that starts a matrix (either may be 0).  Returns rows
+    void setCols(int c);                        // no header: rows of c>0 values until end of file
+    bool nextRow(Matrix &row);                  // read the next row into a 1 X cols matrix.  false at the end
+    int nextChunk(Matrix &chunk, int maxRows);  // read up to maxRows rows into chunk.  Returns rows read (0 at the end)
+    int row() const { return numRead; }         // number of rows read so far
+    int numCols() const { return numc; }
+    SymbolNumMap *symbols() const { return syms; }   // the map strings were added to
+};
+
+#endif
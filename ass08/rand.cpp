@@ -1,51 +1,208 @@
 #include "rand.h"
+#include <string.h>
+#include <mutex>
 
 ///////////////////////////////////////////////////
 //
 // Simple 64 bit random number generators based on
-// a RNG called flea by Bob Jenkins.   Thanks, Bob!
+// xoshiro256** by David Blackman and Sebastiano Vigna.
+// It replaces flea by Bob Jenkins (thanks, Bob!) because
+// the state of xoshiro256** changes linearly so it can jump ahead 2^128 numbers
+// which splits it into streams that provably never overlap.
 //
-// http://burtleburtle.net/bob/rand/talksmall.html
+// https://prng.di.unimi.it/
 //
 
-// these constants are supplied to make the RNG return numbers
-// on the open interval [0, 1)
+// these constants are supplied to make randCauchy map random numbers
+// onto angles in (-pi/2, pi/2)
 #define PIDIV2	    1.570796326794896619231321691639751442099L
 #define PI  	    3.141592653589793238462643383279502884197L
 
-static double unitizer64 = 1.0/18446744073709551616.0;
-static double unitizer64_2 = 2.0/18446744073709551616.0;
 static double unitizer64_pi = PI/18446744073709551616.0;
 
-static bool IAmInitialized=false;
-
 ///////////////////////////////////////////////////
 //
 // basic fast 64 bit random number generation
 //
-static unsigned long long int V, W, X, Y, Z;
+// Each thread has its own stream so there is no locking and threads
+// never see each other's numbers.  A thread that was never given a
+// stream is seeded on first use with one split off from the stream
+// initRand last seeded (seedStream), which is the only time a lock is
+// taken.
+static thread_local RandState current;
+static RandState seedStream;
+static std::mutex seedLock;
+
+
+// give the current thread a stream split off from seedStream
+static void seedCurrent()
+{
+    std::lock_guard<std::mutex> lock(seedLock);
+
+    if (!seedStream.initialized) {
+        printf("ERROR(rand): requires initialization first with a call to the function initRand()\n");
+        exit(1);
+    }
+    current = randSplit(seedStream);
+}
+
+
+// the current thread's stream, seeded first if the thread has none
+static inline RandState &currentState()
+{
+    if (!current.initialized) seedCurrent();
+
+    return current;
+}
+
+
+// the current thread's stream
+RandState &randState() { return currentState(); }
+
 
-// initialize the random number generator using a pair of seeds
+static inline unsigned long long int rotl(unsigned long long int x, int k)
+{
+    return (x<<k) | (x>>(64-k));
+}
+
+
+// the next 64 bits of a stream
+static inline unsigned long long int nextRand(RandState &state)
+{
+    unsigned long long int *s = state.s;
+    unsigned long long int result = rotl(s[1]*5, 7)*9;
+    unsigned long long int t = s[1]<<17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+
+// turn the top 52 bits of u into a double in [0,1).  The bits go under
+// the exponent of 1.0 to make a double in [1,2) so no 64 bit int to
+// double conversion is needed, and taking off 1 leaves a number that
+// can never round up to 1.
+static inline double bitsToUnit(unsigned long long int u)
+{
+    double x;
+
+    u = (u>>12) | 0x3FF0000000000000ULL;
+    memcpy(&x, &u, sizeof(x));
+
+    return x - 1.0;
+}
+
+
+// a random int in [0, m-1] by Lemire's multiply and shift (2019).  The
+// top 32 bits of a random number times m is a 64 bit number whose top
+// half is the answer.  It is unbiased if draws whose low half is below
+// 2^32 mod m are thrown away, and since low<m is needed before that can
+// happen the division to compute 2^32 mod m is almost never done.  So
+// unlike % there is no division and no bias toward small answers.
+static inline int boundedRand(RandState &state, int m)
+{
+    unsigned long long int prod = (nextRand(state)>>32) * (unsigned int)m;
+    unsigned int low = (unsigned int)prod;
+
+    if (low<(unsigned int)m) {
+        unsigned int threshold = -(unsigned int)m % (unsigned int)m;
+
+        while (low<threshold) {
+            prod = (nextRand(state)>>32) * (unsigned int)m;
+            low = (unsigned int)prod;
+        }
+    }
+
+    return prod>>32;
+}
+
+
+// one step of splitmix64, used to spread the seeds over the state
+static unsigned long long int splitMix(unsigned long long int &x)
+{
+    unsigned long long int z = (x += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z>>30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z>>27)) * 0x94D049BB133111EBULL;
+    return z ^ (z>>31);
+}
+
+
+// initialize a stream using a pair of seeds
+void initRand(RandState &state, unsigned long long int a, unsigned long long int b)
+{
+    unsigned long long int x = a ^ rotl(b, 32) ^ 0x6A09E667F3BCC909ULL;
+
+    do {
+        for (int i=0; i<4; i++) state.s[i] = splitMix(x);
+    } while ((state.s[0] | state.s[1] | state.s[2] | state.s[3])==0);   // the all zero state is stuck
+    state.initialized = true;
+}
+
+
+// initialize the current thread's stream using a pair of seeds.  The
+// seeds also start seedStream so threads seeded later from it get
+// streams that do not overlap this one.
 void initRand(unsigned long long int a, unsigned long long int b)
 {
-    V = 1415926535897932ULL;
-    W = 3846264338327950ULL;
-    X = 2884197169399375ULL;
-    Y = 105820974944592ULL;
-    Z = 3078164062862089ULL;
-    Z += a;
-    X += b;
-    for (unsigned long long int i=0; i<((a+b) % 1000)+1000; i++) randULL();
+    std::lock_guard<std::mutex> lock(seedLock);
 
-    IAmInitialized = true;
+    initRand(seedStream, a, b);
+    current = randSplit(seedStream);
 }
 
 
-// is the random number generator initialized?
-//
-// why doesn't call to the various rand routines call this? Answer:
-// because it would slow things down.
-bool isInitRand() { return IAmInitialized; }
+// advance a stream by 2^128 numbers.  A stream has period 2^256-1 so
+// this gives 2^128 streams of 2^128 numbers each that do not overlap.
+void randJump(RandState &state)
+{
+    static const unsigned long long int jump[4] = {
+        0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+    };
+    unsigned long long int s[4] = {0, 0, 0, 0};
+
+    for (int i=0; i<4; i++) {
+        for (int b=0; b<64; b++) {
+            if (jump[i] & (1ULL<<b)) {
+                for (int j=0; j<4; j++) s[j] ^= state.s[j];
+            }
+            nextRand(state);
+        }
+    }
+    for (int j=0; j<4; j++) state.s[j] = s[j];
+}
+
+
+// split off a stream: returns state as it is and jumps state 2^128
+// numbers ahead so the two do not overlap.  To run threads
+// reproducibly give each one randSplit(randState()) from the starting
+// thread and have it set randState() to that before use.
+RandState randSplit(RandState &state)
+{
+    RandState child = state;
+
+    randJump(state);
+
+    return child;
+}
+
+
+// is the current thread's random number generator initialized or can
+// it be seeded from seedStream?
+bool isInitRand()
+{
+    if (current.initialized) return true;
+
+    std::lock_guard<std::mutex> lock(seedLock);
+
+    return seedStream.initialized;
+}
 
 
 // initialize the random number generator using process id and time
@@ -62,39 +219,50 @@ void initRand()
 
 
 // return a 64 bit unsigned uniformly distributed random number
-inline unsigned long long int randULL()
+unsigned long long int randULL()
 {
-    V = W;
-    W = X;
-    X = ((Y<<41) + (Y>>23)) + Z;
-    Y = Z ^ W;
-    Z = V + X;
+    return nextRand(currentState());
+}
+
+
+// return a 64 bit unsigned uniformly distributed random number from a stream
+unsigned long long int randULL(RandState &state)
+{
+    return nextRand(state);
+}
+
 
-    return Y;
+// return a uniformly distributed random number between 0 and 1 from a stream
+double randUnit(RandState &state)
+{
+    return bitsToUnit(nextRand(state));
+}
+
+
+// return a uniformly distributed random number between 0 and m-1 from a stream
+int randMod(RandState &state, int m)
+{
+    return boundedRand(state, m);
 }
 
 // return a uniformly distributed random number between 0 and 1
-// NOTE: this can be relatively slow since the multiply is a 64 bit
-// multiply.
 double randUnit()
 {
-    return randULL()*unitizer64;
+    return bitsToUnit(nextRand(currentState()));
 }
 
 
 
 // return a uniformly distributed random number between -1 and 1
-// NOTE: this can be relatively slow since the multiply is a 64 bit
-// multiply.
 double randPMUnit()
 {
-    return randULL()*unitizer64_2 - 1.0;
+    return bitsToUnit(nextRand(currentState()))*2.0 - 1.0;
 }
 
 
 // return a uniformly distributed random number between 0 and m-1
 int randMod(int m) {
-    return randULL()%m;
+    return boundedRand(currentState(), m);
 }
 
 
@@ -145,32 +313,119 @@ bool chooseMask(unsigned long long int mask, int prob)
 }
 
 
-// Random number generator with normal (Gaussian) distribution
-// from p 117 of Knuth vol 2 2nd ed.
-// Note: this is slow.   Should use the Ziggurat method some day.
-static bool gotSpare64=false;
-static double spare64;
-double randNorm(double stddev)
-{
-    double u, v, s;
+// Random number generators with normal (Gaussian) and exponential
+// distributions by the Ziggurat method of Marsaglia and Tsang (2000).
+// The area under the density is covered by 256 strips of equal area:
+// 255 rectangles stacked on a base strip that is a rectangle plus the
+// tail.  One 64 bit number picks a strip with its low 8 bits and a
+// point across it with its top 52 bits.  About 99% of the time the
+// point is inside the part of the strip wholly under the curve and is
+// returned at the cost of a multiply and compare.  Otherwise the
+// point is checked against the curve itself or, for the base strip,
+// drawn from the tail.
+//
+// x[i] is the right edge of strip i (x[0] is the width the base strip
+// would have as a rectangle and x[256] is 0) and f[i] the density
+// there.  The tables are built once at startup from the tail start R
+// and the strip area V.
+
+struct Ziggurat {
+    double x[257];
+    double f[257];
+    double r;
+
+    // density is the unnormalized density, inverse its inverse
+    Ziggurat(double r, double v, double (*density)(double), double (*inverse)(double)) {
+        this->r = r;
+        x[0] = v/density(r);
+        x[1] = r;
+        for (int i=2; i<256; i++) x[i] = inverse(v/x[i-1] + density(x[i-1]));
+        x[256] = 0;
+        for (int i=0; i<=256; i++) f[i] = density(x[i]);
+    }
+};
+
+static double normalDensity(double x) { return exp(-0.5*x*x); }
+static double normalInverse(double y) { return sqrt(-2*log(y)); }
+static double expDensity(double x) { return exp(-x); }
+static double expInverse(double y) { return -log(y); }
+
+static const Ziggurat normalZig(3.6541528853610088, 0.00492867323399, normalDensity, normalInverse);
+static const Ziggurat expZig(7.69711747013104972, 0.0039496598225815571993, expDensity, expInverse);
 
-    if (gotSpare64) {
-        gotSpare64=false;
-        return spare64;
+
+// a standard normal number (mean 0, stddev 1) from a stream
+static inline double zigNormal(RandState &state)
+{
+    for (;;) {
+        unsigned long long int u = nextRand(state);
+        int i = u & 0xff;
+        double t = 2*bitsToUnit(u) - 1;      // in [-1,1)
+        double x = t*normalZig.x[i];
+
+        if (fabs(t)*normalZig.x[i]<normalZig.x[i+1]) return x;
+
+        // the tail beyond r.  Marsaglia's method for a normal tail
+        if (i==0) {
+            double a, b;
+
+            do {
+                a = -log(1.0-bitsToUnit(nextRand(state)))/normalZig.r;
+                b = -log(1.0-bitsToUnit(nextRand(state)));
+            } while (b+b<a*a);
+
+            return t<0 ? -normalZig.r-a : normalZig.r+a;
+        }
+
+        // the part of the strip that sticks out past the curve
+        if (normalZig.f[i+1] + (normalZig.f[i]-normalZig.f[i+1])*bitsToUnit(nextRand(state)) < normalDensity(x)) {
+            return x;
+        }
     }
-    else {
-        do {
-            u = 2*randUnit() - 1;
-            v = 2*randUnit() - 1;
-            s = u*u + v*v;
-        } while (s>=1.0 || s==0.0);
+}
+
+
+// a standard exponential number (mean 1) from a stream
+static inline double zigExp(RandState &state)
+{
+    for (;;) {
+        unsigned long long int u = nextRand(state);
+        int i = u & 0xff;
+        double x = bitsToUnit(u)*expZig.x[i];
+
+        if (x<expZig.x[i+1]) return x;
+
+        // the tail beyond r is r plus another exponential
+        if (i==0) return expZig.r - log(1.0-bitsToUnit(nextRand(state)));
+
+        if (expZig.f[i+1] + (expZig.f[i]-expZig.f[i+1])*bitsToUnit(nextRand(state)) < expDensity(x)) {
+            return x;
+        }
     }
+}
 
-    s = sqrt(-2*log(s)/s)*stddev;
-    spare64 = v*s;
-    gotSpare64 = true;
 
-    return u*s;
+double randNorm(RandState &state, double stddev)
+{
+    return zigNormal(state)*stddev;
+}
+
+
+double randNorm(double stddev)
+{
+    return zigNormal(currentState())*stddev;
+}
+
+
+double randExp(RandState &state, double mean)
+{
+    return zigExp(state)*mean;
+}
+
+
+double randExp(double mean)
+{
+    return zigExp(currentState())*mean;
 }
 
 
@@ -204,11 +459,115 @@ double randCauchy(double mean, double scale)
 
 
 
+///////////////////////////////////////////////////
+//
+// bulk fills
+//
+// These work on a copy of the current stream kept in registers for the
+// whole fill.  Uniform fills make a block of raw bits before turning
+// the block into doubles (see bitsToUnit) in a separate loop the
+// compiler can vectorize.
+//
+static const int fillBlock = 256;
+
+
+// n 64 bit random numbers
+void randFillULL(unsigned long long int *x, int n)
+{
+    RandState state = currentState();
+
+    for (int i=0; i<n; i++) x[i] = nextRand(state);
+
+    current = state;
+}
+
+
+// n uniformly distributed random reals in [min, max)
+void randFillUniform(double *x, int n, double min, double max)
+{
+    unsigned long long int bits[fillBlock];
+    RandState state = currentState();
+    double scale = max-min;
+
+    for (int i=0; i<n; i+=fillBlock) {
+        int k = n-i<fillBlock ? n-i : fillBlock;
+
+        for (int j=0; j<k; j++) bits[j] = nextRand(state);
+        for (int j=0; j<k; j++) x[i+j] = bitsToUnit(bits[j])*scale + min;
+    }
+
+    current = state;
+}
+
+
+// n normally distributed random reals
+void randFillNormal(double *x, int n, double mean, double stddev)
+{
+    RandState state = currentState();
+
+    for (int i=0; i<n; i++) x[i] = zigNormal(state)*stddev + mean;
+
+    current = state;
+}
+
+
+// n exponentially distributed random reals
+void randFillExp(double *x, int n, double mean)
+{
+    RandState state = currentState();
+
+    for (int i=0; i<n; i++) x[i] = zigExp(state)*mean;
+
+    current = state;
+}
+
+
+// n uniformly distributed random ints in [0, m-1]
+void randFillMod(int *x, int n, int m)
+{
+    if (m<=0) {
+        printf("ERROR(randFillMod): the number of values to choose from must be positive but is %d\n", m);
+        exit(1);
+    }
+
+    RandState state = currentState();
+
+    for (int i=0; i<n; i++) x[i] = boundedRand(state, m);
+
+    current = state;
+}
+
+
+// n uniformly distributed random ints in [min, max) stored as doubles
+void randFillInt(double *x, int n, int min, int max)
+{
+    if ((long long)max-min<=0 || (long long)max-min>2147483647LL) {
+        printf("ERROR(randFillInt): the range [%d, %d) must be nonempty and hold at most 2^31-1 values\n", min, max);
+        exit(1);
+    }
+
+    RandState state = currentState();
+    int m = max-min;
+
+    for (int i=0; i<n; i++) x[i] = boundedRand(state, m) + min;
+
+    current = state;
+}
+
+
 
 /*
+// speed of randMod (Lemire's method) against the older ways of getting
+// a random int in [0, m-1]: plain % (biased) and rejection sampling
+// with a mask, which randMod makes unnecessary.
+// usage: ./a.out m
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 // Return a uniformly distributed random number between 0 and m-1.
 // Suitable for 0 < m < 2^16.
@@ -222,13 +581,10 @@ double randCauchy(double mean, double scale)
 // smallest right justified all ones mask containing m-1.  If m=6 then
 // mask=7.
 int randMod(unsigned long long int mask, int m) {
+    unsigned long long int Y;
     int ans;
     do {
-        V = W;
-        W = X;
-        X = ((Y<<41) + (Y>>23)) + Z;
-        Y = Z ^ W;
-        Z = V + X;
+        Y = randULL();
 
         ans = Y&mask;
         if (ans<m) return ans;
@@ -259,18 +615,133 @@ static unsigned long long int smallestMask(unsigned long long int x) {
 
 
 int main(int argc, char *argv[]) {
+    const int n = 100000000;
     initRand();
     int m;
-    int z;
+    long long z;
     unsigned long long int mask;
-    z = 0;
+    double t;
     m = atoi(argv[1]);
     mask = smallestMask(m-1);
-    for (int i=0; i<100000000; i++) {
-//        printf("%d\n", randMod(63ULL, 17));
-        z+=randMod(mask, m);
-//       z+=randMod(m);
+
+    t = seconds();
+    z = 0;
+    for (int i=0; i<n; i++) z+=randMod(m);
+    printf("randMod (Lemire): %.4lf sec (%lld)\n", seconds()-t, z);
+
+    t = seconds();
+    z = 0;
+    for (int i=0; i<n; i++) z+=randULL()%m;
+    printf("randULL()%%m:      %.4lf sec (%lld)\n", seconds()-t, z);
+
+    t = seconds();
+    z = 0;
+    for (int i=0; i<n; i++) z+=randMod(mask, m);
+    printf("mask rejection:   %.4lf sec (%lld)\n", seconds()-t, z);
+
+    return 0;
+}
+*/
+
+
+/*
+// statistical check and speed of the Ziggurat randNorm and randExp.
+// Prints the first four moments and a chi-square statistic over 100
+// equal probability bins (99 degrees of freedom so about 99 +- 14 is
+// fine) for each, then the time for n normals by Ziggurat and by the
+// polar method randNorm used before.
+// usage: ./a.out n
+#include <chrono>
+static double seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double polar(double stddev)
+{
+    static bool gotSpare = false;
+    static double spare;
+    double u, v, s;
+
+    if (gotSpare) {
+        gotSpare = false;
+        return spare;
+    }
+    do {
+        u = 2*randUnit() - 1;
+        v = 2*randUnit() - 1;
+        s = u*u + v*v;
+    } while (s>=1.0 || s==0.0);
+
+    s = sqrt(-2*log(s)/s)*stddev;
+    spare = v*s;
+    gotSpare = true;
+
+    return u*s;
+}
+
+static void check(const char *what, double *x, int n, double (*cdf)(double))
+{
+    const int bins = 100;
+    double count[bins] = {0};
+    double m1 = 0, m2 = 0, m3 = 0, m4 = 0, chi = 0, d;
+
+    for (int i=0; i<n; i++) m1 += x[i];
+    m1 /= n;
+    for (int i=0; i<n; i++) {
+        d = x[i]-m1;
+        m2 += d*d;
+        m3 += d*d*d;
+        m4 += d*d*d*d;
+        int b = cdf(x[i])*bins;
+        count[b<0 ? 0 : b>=bins ? bins-1 : b]++;
     }
-    return z;
+    m2 /= n;
+    m3 /= n;
+    m4 /= n;
+    for (int b=0; b<bins; b++) chi += (count[b]-double(n)/bins)*(count[b]-double(n)/bins)/(double(n)/bins);
+
+    printf("%s: mean %.5f  variance %.5f  skew %.5f  kurtosis %.5f  chi-square %.1f\n",
+           what, m1, m2, m3/pow(m2, 1.5), m4/(m2*m2), chi);
+}
+
+static double normalCdf(double x) { return 0.5*erfc(-x/sqrt(2.0)); }
+static double expCdf(double x) { return 1.0-exp(-x); }
+
+int main(int argc, char *argv[])
+{
+    int n = atoi(argv[1]);
+    double *x = new double [n];
+    double t, sum;
+
+    initRand();
+
+    randFillNormal(x, n, 0.0, 1.0);
+    check("normal (expect 0 1 0 3)", x, n, normalCdf);
+    randFillExp(x, n, 1.0);
+    check("exponential (expect 1 1 2 9)", x, n, expCdf);
+
+    t = seconds();
+    sum = 0;
+    for (int i=0; i<n; i++) sum += randNorm(1.0);
+    printf("ziggurat randNorm: %.4lf sec (%g)\n", seconds()-t, sum);
+
+    t = seconds();
+    sum = 0;
+    for (int i=0; i<n; i++) sum += polar(1.0);
+    printf("polar method:      %.4lf sec (%g)\n", seconds()-t, sum);
+
+    t = seconds();
+    sum = 0;
+    for (int i=0; i<n; i++) sum += randExp(1.0);
+    printf("ziggurat randExp:  %.4lf sec (%g)\n", seconds()-t, sum);
+
+    t = seconds();
+    sum = 0;
+    for (int i=0; i<n; i++) sum += -log(1.0-randUnit());
+    printf("-log(uniform):     %.4lf sec (%g)\n", seconds()-t, sum);
+
+    delete [] x;
+
+    return 0;
 }
 */
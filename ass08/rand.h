@@ -50,6 +50,39 @@ unsigned long long randCoinToss();         // 50:50 true or false
 bool     choose8(int eigth);               // fast choose based on prob in 1/8 increments
 bool     chooseMask(unsigned long long int mask, int prob); 
 double   randNorm(double stddev);          // normal distribution with (mean=0)
+double   randExp(double mean);             // exponential distribution with the given mean
 double   randCauchy();                     // Cauchy distribution (mean=0, scale=1)
 double   randCauchy(double mean, double scale);
+
+// bulk fills: the same as calling the above once per element but faster
+void     randFillULL(unsigned long long int *x, int n);   // n 64 bit random numbers
+void     randFillUniform(double *x, int n, double min=0.0, double max=1.0);   // n random reals in [min,max)
+void     randFillNormal(double *x, int n, double mean, double stddev);      // n reals in a normal distribution
+void     randFillExp(double *x, int n, double mean);       // n reals in an exponential distribution
+void     randFillMod(int *x, int n, int m);                // n random ints in [0,m-1]
+void     randFillInt(double *x, int n, int min, int max);  // n random ints in [min,max) stored as doubles
+
+// Random number streams.  Each thread has its own current stream
+// (see randState) which all the calls above use, so threads never share
+// state.  initRand must be called once before use.  A thread can be
+// given its own stream with initRand or by setting randState() to one
+// split off from another with randSplit; a thread that was given none
+// is seeded on first use with a stream split off from the one initRand
+// last seeded.  randJump advances a stream 2^128 numbers so streams split
+// from one seed never overlap and a parallel run with a given seed
+// gives the same numbers every time.
+struct RandState {
+    unsigned long long int s[4];   // generator state
+    bool initialized;              // has the state been seeded?
+};
+
+RandState &randState();                    // the current thread's stream
+void     initRand(RandState &state, unsigned long long int a, unsigned long long int b);  // init a stream with 2 seeds
+void     randJump(RandState &state);       // advance the stream 2^128 numbers
+RandState randSplit(RandState &state);     // return state and jump state past it
+unsigned long long int randULL(RandState &state);   // 64 bits random number from the given stream
+double   randUnit(RandState &state);       // random [0,1) from the given stream
+int      randMod(RandState &state, int m); // random int in [0,m-1] from the given stream
+double   randNorm(RandState &state, double stddev);   // normal distribution from the given stream
+double   randExp(RandState &state, double mean);      // exponential distribution from the given stream
 #endif
@@ -0,0 +1,66 @@
+// Test that the serial and the parallel text readers give the same
+// matrix, including number tokens too long for the readers' stack
+// buffers.  Build with: make t
+#include "mat.h"
+#include <string.h>
+
+int main()
+{
+    const char *filename = "/tmp/longtoken.txt";
+    const int rows = 20000, cols = 5;
+    std::string big = "1" + std::string(200, '0');               // 1e200
+    std::string third = "0." + std::string(300, '3');            // 1/3
+    Matrix serial, parallel;
+    FILE *OUT;
+    int fail;
+
+    // a file big enough to be split between threads with long tokens
+    // at the start, in the middle and at the end
+    OUT = fopen(filename, "w");
+    if (OUT==NULL) {
+        printf("ERROR(t): can't write %s\n", filename);
+        exit(1);
+    }
+    fprintf(OUT, "%d %d\n", rows, cols);
+    for (int r=0; r<rows; r++) {
+        for (int c=0; c<cols; c++) {
+            if ((r==0 || r==rows/2 || r==rows-1) && c==1) fprintf(OUT, "%s ", big.c_str());
+            else if ((r==0 || r==rows/2 || r==rows-1) && c==3) fprintf(OUT, "%s ", third.c_str());
+            else fprintf(OUT, "%d.%d ", r, c);
+        }
+        fprintf(OUT, "\n");
+    }
+    fclose(OUT);
+
+    Matrix::readThreads = 1;
+    serial.read(filename);
+
+    Matrix::readThreads = 4;
+    Matrix::parallelReadMin = 0;
+    parallel.read(filename);
+
+    fail = 0;
+    for (int r=0; r<rows; r++) {
+        for (int c=0; c<cols; c++) {
+            double x = serial.get(r, c), y = parallel.get(r, c);
+
+            if (memcmp(&x, &y, sizeof(x))!=0) {
+                printf("FAIL: element [%d, %d] serial %.17g parallel %.17g\n", r, c, x, y);
+                fail = 1;
+            }
+        }
+    }
+    if (serial.get(rows/2, 1)!=1e200 || parallel.get(rows/2, 1)!=1e200) {
+        printf("FAIL: 201 digit token read as %.17g serial %.17g parallel\n", serial.get(rows/2, 1), parallel.get(rows/2, 1));
+        fail = 1;
+    }
+    if (serial.get(0, 3)!=1.0/3.0 || parallel.get(rows-1, 3)!=1.0/3.0) {
+        printf("FAIL: 302 character token read as %.17g serial %.17g parallel\n", serial.get(0, 3), parallel.get(rows-1, 3));
+        fail = 1;
+    }
+    remove(filename);
+
+    printf("%s\n", fail ? "FAILED" : "PASSED");
+
+    return fail;
+}